@@ -25,7 +25,7 @@ void FakeHttpServer::stop() {
 	stopFlag_.notify_one();
 }
 
-void FakeHttpServer::onNewConnection(rapid::ConnectionPtr pConn) {
+void FakeHttpServer::onNewConnection(rapid::ConnectionHandle pConn) {
 	static const std::string s_httpReplyContent{
 		"HTTP/1.1 200 OK\r\n"
 		"Content-Length: 100\r\n"
@@ -50,15 +50,15 @@ void FakeHttpServer::onNewConnection(rapid::ConnectionPtr pConn) {
 
 void FakeHttpServer::start() {
 	server_.startListening([this](rapid::ConnectionPtr pConn) {
-		pConn->setSendEventHandler([this](rapid::ConnectionPtr conn) {
+		pConn->setSendEventHandler([this](rapid::ConnectionHandle conn) {
 			onNewConnection(conn);
 		});
 
-		pConn->setReceiveEventHandler([this](rapid::ConnectionPtr conn) {
+		pConn->setReceiveEventHandler([this](rapid::ConnectionHandle conn) {
 			onNewConnection(conn);
 		});
 
-		pConn->setAcceptEventHandler([this](rapid::ConnectionPtr conn) {
+		pConn->setAcceptEventHandler([this](rapid::ConnectionHandle conn) {
 			onNewConnection(conn);
 		});
 	});
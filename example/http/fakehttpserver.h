@@ -32,7 +32,7 @@ private:
 		TCP_BUFFER_SIZE = 64 * 1024
 	};
 
-	void onNewConnection(rapid::ConnectionPtr pConn);
+	void onNewConnection(rapid::ConnectionHandle pConn);
 
 	rapid::TcpServer server_;
 	std::mutex waitStopMutex_;
@@ -13,6 +13,7 @@
 
 #include <rapid/logging/logging.h>
 #include <rapid/platform/utils.h>
+#include <rapid/details/memorygovernor.h>
 
 #include "httpserverconfigfacade.h"
 #include "filecachemanager.h"
@@ -192,6 +193,15 @@ bool HttpFileCacheReader::read(rapid::IoBuffer *pBuffer, uint32_t bufferLen) {
 	return false;
 }
 
+HANDLE HttpFileCacheReader::getFileHandle() const {
+	return INVALID_HANDLE_VALUE;
+}
+
+rapid::IoSlice HttpFileCacheReader::getSlice() const {
+	// The cached content is never modified, every response shares it.
+	return rapid::IoSlice(std::shared_ptr<std::vector<char> const>(pFileCache_));
+}
+
 HttpSampleFileReader::HttpSampleFileReader()
 	: handle_(INVALID_HANDLE_VALUE) {
 }
@@ -210,7 +220,7 @@ void HttpSampleFileReader::open(std::string const& filePath) {
 		FILE_SHARE_READ,
 		nullptr,
 		OPEN_EXISTING,
-		0,
+		FILE_FLAG_SEQUENTIAL_SCAN,
 		nullptr);
 	RAPID_ENSURE(handle_ != INVALID_HANDLE_VALUE);
 }
@@ -257,6 +267,10 @@ bool HttpSampleFileReader::read(rapid::IoBuffer* pBuffer, uint32_t bufferLen) {
 	return false;
 }
 
+HANDLE HttpSampleFileReader::getFileHandle() const {
+	return handle_;
+}
+
 // Sample Win32 File API Wrapper
 class File {
 public:
@@ -320,11 +334,19 @@ std::shared_ptr<std::vector<char>> FileCacheManager::getFromMemoryCache(std::str
 	if (compress) {
 		auto pCompressFileCache = std::make_shared<std::vector<char>>();
 		gzipCompress(*pFileCache, *pCompressFileCache);
+		pFileCache = pCompressFileCache;
+	}
 
-		memoryCacheMap_[filePath] = pCompressFileCache;
-		return pCompressFileCache;
-	} else {
-		memoryCacheMap_[filePath] = pFileCache;
+	// Over the memory budget the file is served from this copy without being cached.
+	auto &governor = rapid::details::MemoryGovernor::getInstance();
+	if (!governor.tryCharge(rapid::details::MEMORY_FILE_CACHE, pFileCache->capacity())) {
+		return pFileCache;
+	}
+	auto result = memoryCacheMap_.insert(std::make_pair(filePath, pFileCache));
+	if (!result.second) {
+		// Another thread cached it meanwhile.
+		governor.release(rapid::details::MEMORY_FILE_CACHE, pFileCache->capacity());
+		return (*result.first).second;
 	}
 	return pFileCache;
 }
@@ -382,7 +404,8 @@ std::shared_ptr<HttpFileReader> FileCacheManager::getFileReaderFromPool(std::str
 		} else {
 			if (cookie.fileSize <= NO_CACHE_SIZE) {
 				preReadFile(filePath);
-			} else if (HttpServerConfigFacade::getInstance().getBufferSize() > SIZE_64KB) {
+			} else if (HttpServerConfigFacade::getInstance().isUseSSL()
+				&& HttpServerConfigFacade::getInstance().getBufferSize() > SIZE_64KB) {
 				// ʭ:
 				// ϥMemory mapped fileŪɮ, OݭnwİϤj64KBHW
 				return HttpFileReaderPtr(new HttpMemoryFileReader(filePath), deleter);
@@ -472,3 +495,7 @@ bool HttpMemoryFileReader::read(rapid::IoBuffer * pBuffer, uint32_t bufferLen) {
 
 	return false;
 }
+
+HANDLE HttpMemoryFileReader::getFileHandle() const {
+	return INVALID_HANDLE_VALUE;
+}
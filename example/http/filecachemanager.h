@@ -13,6 +13,7 @@
 #include <rapid/platform/spinlock.h>
 #include <rapid/platform/memorymappedfile.h>
 #include <rapid/iobuffer.h>
+#include <rapid/ioslice.h>
 
 class HttpFileReader {
 public:
@@ -28,6 +29,14 @@ public:
 
 	virtual bool read(rapid::IoBuffer *pBuffer, uint32_t bufferLen) = 0;
 
+	// Returns INVALID_HANDLE_VALUE if the content can't be sent by TransmitFile.
+	virtual HANDLE getFileHandle() const = 0;
+
+	// The whole content shared by reference, an empty slice if it isn't held in memory.
+	virtual rapid::IoSlice getSlice() const {
+		return rapid::IoSlice();
+	}
+
 	HttpFileReader(HttpFileReader const &) = delete;
 	HttpFileReader& operator=(HttpFileReader const &) = delete;
 
@@ -58,6 +67,10 @@ public:
 
 	virtual bool read(rapid::IoBuffer *pBuffer, uint32_t bufferLen) override;
 
+	virtual HANDLE getFileHandle() const override;
+
+	virtual rapid::IoSlice getSlice() const override;
+
 private:
 	std::shared_ptr<std::vector<char>> pFileCache_;
 	int64_t position_;
@@ -81,6 +94,8 @@ public:
 
 	virtual bool read(rapid::IoBuffer *pBuffer, uint32_t bufferLen) override;
 
+	virtual HANDLE getFileHandle() const override;
+
 private:
 	void remappedFile();
 
@@ -113,6 +128,8 @@ public:
 	virtual void seekTo(int64_t postion) override;
 
 	virtual bool read(rapid::IoBuffer *pBuffer, uint32_t bufferLen) override;
+
+	virtual HANDLE getFileHandle() const override;
 private:
 	HANDLE handle_;
 };
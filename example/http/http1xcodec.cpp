@@ -15,7 +15,7 @@ Http1xCodec::Http1xCodec(std::shared_ptr<MessageDispatcher<HttpRequest>> disp)
 	pHttpRequest_ = std::shared_ptr<HttpRequest>(HttpServerConfigFacade::getInstance().getHttpRequestPool().borrowObject());
 }
 
-void Http1xCodec::readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) {
+void Http1xCodec::readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) {
 	auto buffer = pConn->getReceiveBuffer();
 	if (buffer->isEmpty()) {
 		bytesToRead = buffer->goodSize();
@@ -24,7 +24,7 @@ void Http1xCodec::readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) {
 	parse(buffer, pConn);
 }
 
-void Http1xCodec::parse(rapid::IoBuffer* buffer, rapid::ConnectionPtr& pConn) {
+void Http1xCodec::parse(rapid::IoBuffer* buffer, rapid::ConnectionHandle & pConn) {
 	char const* method = nullptr;
 	char const* path = nullptr;
 
@@ -56,13 +56,14 @@ void Http1xCodec::parse(rapid::IoBuffer* buffer, rapid::ConnectionPtr& pConn) {
 
 		// Successfully parsed the request.
 		for (size_t i = 0; i < numHeaders; ++i) {
-			std::string name(headers_[i].name, headers_[i].name_len);
-			std::string value(headers_[i].value, headers_[i].value_len);
-			pHttpRequest_->add(name, value);
+			pHttpRequest_->add(headers_[i].name,
+				static_cast<uint32_t>(headers_[i].name_len),
+				headers_[i].value,
+				static_cast<uint32_t>(headers_[i].value_len));
 		}
 
 		pHttpRequest_->setVersion(minorVersion);
-		pHttpRequest_->setMethod(std::string(method, methodLen));
+		pHttpRequest_->setMethod(method, methodLen);
 		pHttpRequest_->setUri(path, pathLen);
 		dispatcher_->onMessage(pHttpRequest_->method(), pConn, pHttpRequest_);
 	} else {
@@ -24,10 +24,10 @@ public:
 	Http1xCodec(Http1xCodec const &) = delete;
 	Http1xCodec& operator=(Http1xCodec const &) = delete;
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) override;
+	virtual void readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) override;
 
 private:
-	void parse(rapid::IoBuffer *buffer, rapid::ConnectionPtr &pConn);
+	void parse(rapid::IoBuffer *buffer, rapid::ConnectionHandle &pConn);
 
 	struct phr_header headers_[HTTP_HEADER_MAX];
 	std::shared_ptr<MessageDispatcher<HttpRequest>> dispatcher_;
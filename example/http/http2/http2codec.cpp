@@ -210,7 +210,7 @@ void Http2Response::writeHeadersFrame(rapid::IoBuffer *pBuffer) {
 	}
 }
 
-bool Http2Response::send(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpRequest> httpRequest) {
+bool Http2Response::send(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpRequest> httpRequest) {
 	auto pHttp2Request = std::dynamic_pointer_cast<Http2Request>(httpRequest);
 	
 	if (pHttp2Request->priorityQueue_.empty()) {
@@ -243,6 +243,15 @@ bool Http2Response::send(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpReques
 	return false;
 }
 
+bool Http2Response::canTransmitFile() const {
+	// Content must be split into DATA frames.
+	return false;
+}
+
+bool Http2Response::canEnqueueContent() const {
+	return false;
+}
+
 bool Http2Response::writeContent(rapid::IoBuffer *pBuffer) {
 	if (stream_->state == H2_STREAM_STATE_CLOSED) {
 		RAPID_LOG_TRACE() << "Stream " << stream_->getStreamId() << " Closed";
@@ -309,8 +318,8 @@ void Http2Response::doSerialize(rapid::IoBuffer *pBuffer) {
 	writeHeadersFrame(pBuffer);
 
 	Http2Hpack::encodeHeader(pBuffer, H2_HEADER_STATUS, std::to_string(statusCode()));
-	headers_.foreach([pBuffer](std::string const &name, std::string const &value) {
-		Http2Hpack::encodeHeader(pBuffer, name, value);
+	headers_.foreach([pBuffer](std::string const &name, HttpHeaderValue const &value) {
+		Http2Hpack::encodeHeader(pBuffer, name, std::string(value.c_str(), value.length()));
 	});
 
 	sendCount_ = getContentLength() / getBufferLength();
@@ -327,7 +336,7 @@ Http2Codec::Http2Codec(std::shared_ptr<MessageDispatcher<HttpRequest>> disp)
 Http2Codec::~Http2Codec() {
 }
 
-void Http2Codec::readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) {
+void Http2Codec::readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) {
 	auto pBuffer = pConn->getReceiveBuffer();	
 	auto readDone = false;
 
@@ -390,7 +399,7 @@ bool Http2Codec::parse(rapid::IoBuffer *pBuffer, std::shared_ptr<Http2Stream> &s
 	return false;
 }
 
-void Http2Codec::sendPendingResponse(rapid::ConnectionPtr& pConn) {
+void Http2Codec::sendPendingResponse(rapid::ConnectionHandle & pConn) {
 	dispatcher_->onMessage(HTTP_METHOD_GET, pConn, pHttpRequests_);
 	pHttpRequests_.reset();
 }
@@ -28,13 +28,17 @@ public:
 
 	virtual ~Http2Response() = default;
 
-	virtual bool send(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpRequest> httpRequest) override;
+	virtual bool send(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpRequest> httpRequest) override;
 
 	virtual bool writeContent(rapid::IoBuffer *pBuffer) override;
 
 protected:
 	virtual void doSerialize(rapid::IoBuffer *pBuffer) override;
 
+	virtual bool canTransmitFile() const override;
+
+	virtual bool canEnqueueContent() const override;
+
 private:
 	void writeDataFrame(rapid::IoBuffer *pBuffer);
 
@@ -80,7 +84,7 @@ public:
 
 	virtual ~Http2Codec();
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) override;
+	virtual void readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) override;
 
 private:
 	bool parse(rapid::IoBuffer *pBuffer, std::shared_ptr<Http2Stream> &stream, Http2Frame const &frame);
@@ -109,7 +113,7 @@ private:
 
 	void addRequestHeader(std::map<std::string, std::string> const &headerTable, std::shared_ptr<Http2Stream> &stream, Http2Frame const &frame);
 
-	void sendPendingResponse(rapid::ConnectionPtr& pConn);
+	void sendPendingResponse(rapid::ConnectionHandle & pConn);
 
 	std::shared_ptr<Http2Request> defaultHttpRequest();
 
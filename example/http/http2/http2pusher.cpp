@@ -33,7 +33,7 @@ void Http2Pusher::remove(std::string const& filePath) {
 	resources_.erase(filePath);
 }
 
-void Http2Pusher::push(rapid::ConnectionPtr &pConn) {
+void Http2Pusher::push(rapid::ConnectionHandle &pConn) {
 	auto pBuffer = pConn->getSendBuffer();
 	writePushPromiseFrame(pBuffer);
 }
@@ -79,5 +79,5 @@ void Http2Pusher::setPromisedStreamID(uint32_t streamID) {
 	promisedStreamID_ = streamID;
 }
 
-void Http2Pusher::onPush(rapid::ConnectionPtr &pConn) {
+void Http2Pusher::onPush(rapid::ConnectionHandle &pConn) {
 }
@@ -23,14 +23,14 @@ public:
 
 	void setPromisedStreamID(uint32_t streamID);
 
-	void push(rapid::ConnectionPtr &pConn);
+	void push(rapid::ConnectionHandle &pConn);
 
 private:
 	void writePushPromiseFrame(rapid::IoBuffer *pBuffer);
 
 	void buildPushRequestHeader(rapid::IoBuffer *pBuffer, std::string const &resource);
 
-	void onPush(rapid::ConnectionPtr &pConn);
+	void onPush(rapid::ConnectionHandle &pConn);
 
 	std::unordered_map<std::string, MimeEntry> resources_;
 	uint32_t promisedStreamID_;
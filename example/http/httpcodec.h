@@ -14,7 +14,7 @@ public:
 	HttpCodec(HttpCodec const &) = delete;
 	HttpCodec& operator=(HttpCodec const &) = delete;
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) = 0;
+	virtual void readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) = 0;
 protected:
 	HttpCodec() = default;
 };
@@ -19,8 +19,17 @@
 #include "httpconstants.h"
 #include "httpcontext.h"
 
+// Upgraded connections stream frames for their whole life, a mirrored ring lets the codecs parse
+// frames that straddle the end of the buffer without compacting it.
+static void useRingReceiveBuffer(rapid::ConnectionHandle &pConn) {
+	if (!pConn->getReceiveBuffer()->setRingBuffer(HttpServerConfigFacade::getInstance().getBufferSize())) {
+		RAPID_LOG_TRACE() << "Mirrored ring buffer not supported, keep the linear receive buffer";
+	}
+}
+
 HttpContext::HttpContext()
 	: hasUpgraded_(false)
+	, isReadingRequest_(false)
 	, id_(0) {
 }
 
@@ -33,13 +42,13 @@ void HttpContext::setEventHandler() {
 
 	// HTTP method event handler
 	pHttpMethodDispatcher->addMessageEventHandler(HTTP_METHOD_GET,
-		[this](rapid::ConnectionPtr &conn, HttpRequestPtr httpRequest) {
+		[this](rapid::ConnectionHandle &conn, HttpRequestPtr httpRequest) {
 		pHttpRequest_ = httpRequest;
 		onHttpGetMessage(conn);
 	});
 
 	pHttpMethodDispatcher->addMessageEventHandler(HTTP_METHOD_POST,
-		[this](rapid::ConnectionPtr &conn, HttpRequestPtr httpRequest) {
+		[this](rapid::ConnectionHandle &conn, HttpRequestPtr httpRequest) {
 		pHttpRequest_ = httpRequest;
 		onHttpPostMessage(conn);
 	});
@@ -54,32 +63,30 @@ void HttpContext::setEventHandler() {
 	}
 }
 
-void HttpContext::onAcceptConnection(rapid::ConnectionPtr &pConn) {
+void HttpContext::onAcceptConnection(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 	readLoop(pConn);
 }
 
-void HttpContext::handshake(rapid::ConnectionPtr &pConn) {
+void HttpContext::handshake(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	setEventHandler();
 	
-	pConn->setReceiveEventHandler([this](rapid::ConnectionPtr conn) {
-		readLoop(conn);
-	});
+	pConn->setReceiveEventHandler<HttpContext, &HttpContext::readLoop>(this);
+	pConn->setSendEventHandler<HttpContext, &HttpContext::sendMessage>(this);
 
-	pConn->setSendEventHandler([this](rapid::ConnectionPtr conn) {
-		sendMessage(conn);
-	});
-
-	hasUpgraded_ = false;
+	// An upgraded connection keeps hasUpgraded_ set, it is cleared when the connection goes away.
+	isReadingRequest_ = false;
 
 	onAcceptConnection(pConn);
 }
 
-void HttpContext::onHttpGetMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::onHttpGetMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
+	pConn->cancelDeadline(rapid::Connection::HEADER_READ_DEADLINE);
+
     // HTTP1.1 browserݭn'Connection'Ӫkeep-alive!
     // HTTP2 F'Connection' 
     if (!HttpServerConfigFacade::getInstance().isUseHttp2()) {
@@ -100,9 +107,11 @@ void HttpContext::onHttpGetMessage(rapid::ConnectionPtr &pConn) {
 	}
 }
 
-void HttpContext::onHttpPostMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::onHttpPostMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
+	pConn->cancelDeadline(rapid::Connection::HEADER_READ_DEADLINE);
+
     // HTTP1.1 browserݭn'Connection'Ӫkeep-alive!
     // HTTP2 F'Connection' 
     if (!HttpServerConfigFacade::getInstance().isUseHttp2()) {
@@ -128,7 +137,7 @@ size_t HttpContext::id() const noexcept {
 	return id_;
 }
 
-void HttpContext::readPostData(rapid::ConnectionPtr &pConn) {
+void HttpContext::readPostData(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	if (pHttpRequest_->writeTempFile(pConn)) {
@@ -136,7 +145,22 @@ void HttpContext::readPostData(rapid::ConnectionPtr &pConn) {
 	}
 }
 
-void HttpContext::readLoop(rapid::ConnectionPtr &pConn) {
+void HttpContext::startRequestDeadlines(rapid::ConnectionHandle &pConn) {
+	if (hasUpgraded_ || isReadingRequest_) {
+		return;
+	}
+	isReadingRequest_ = true;
+	pConn->startDeadline(rapid::Connection::HEADER_READ_DEADLINE);
+	pConn->startDeadline(rapid::Connection::REQUEST_DEADLINE);
+}
+
+void HttpContext::stopRequestDeadlines(rapid::ConnectionHandle &pConn) {
+	isReadingRequest_ = false;
+	pConn->cancelDeadline(rapid::Connection::HEADER_READ_DEADLINE);
+	pConn->cancelDeadline(rapid::Connection::REQUEST_DEADLINE);
+}
+
+void HttpContext::readLoop(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	uint32_t bytesToRead = 0;
@@ -144,13 +168,14 @@ void HttpContext::readLoop(rapid::ConnectionPtr &pConn) {
 
 	do {
 		if (!pBuffer->isEmpty()) {
+			startRequestDeadlines(pConn);
 			pHttpCodec_->readLoop(pConn, bytesToRead);
 			if (!bytesToRead) break; // Decode done!
 		}
 	} while (pBuffer->readSome(pConn));
 }
 
-void HttpContext::sendMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::sendMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	while (!pHttpResponse_->send(pConn, pHttpRequest_)) {
@@ -161,17 +186,18 @@ void HttpContext::sendMessage(rapid::ConnectionPtr &pConn) {
 
 	pHttpResponse_->reset();
 	pHttpRequest_->removeAll();
+	stopRequestDeadlines(pConn);
 	readLoop(pConn);
 }
 
-void HttpContext::sendSwitchToHttp2cMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::sendSwitchToHttp2cMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	if (pHttpRequest_->has(HTTP_CONNECTION)) {
-		auto value = pHttpRequest_->get(HTTP_CONNECTION);
-		auto hasHttp2Settings = value.find(HTTP2_SETTINGS.str());
+		auto const &value = pHttpRequest_->get(HTTP_CONNECTION);
+		auto hasHttp2Settings = value.find(HTTP2_SETTINGS.str().c_str());
 		if (hasHttp2Settings) {
-			decodeBase64(pHttpRequest_->get(HTTP2_SETTINGS));
+			decodeBase64(pHttpRequest_->get(HTTP2_SETTINGS).c_str());
 		}
 	}
 
@@ -180,29 +206,30 @@ void HttpContext::sendSwitchToHttp2cMessage(rapid::ConnectionPtr &pConn) {
 	pHttpResponse_->add(HTTP_UPGRADE, HTTP2_UPGRADE_PROTOCOL);
 	pHttpResponse_->serialize(pConn->getSendBuffer());
 
+	// The upgrade request is the last HTTP/1.x request, sendMessage is not reached to stop its deadlines.
+	stopRequestDeadlines(pConn);
 	hasUpgraded_ = true;
+	useRingReceiveBuffer(pConn);
 
-	pConn->setSendEventHandler([this](rapid::ConnectionPtr conn) {
-		handshake(conn);
-	});
+	pConn->setSendEventHandler<HttpContext, &HttpContext::handshake>(this);
 
 	if (pConn->sendAsync()) {
 		handshake(pConn);
 	}
 }
 
-void HttpContext::sendSwitchToWebSocketMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::sendSwitchToWebSocketMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	pHttpResponse_->setStatusCode(HTTP_SWITCHING_PROTOCOLS);
 	pHttpResponse_->add(HTTP_UPGRADE, HTTP_WEBSOCKET.str());
 	pHttpResponse_->add(HTTP_CONNECTION, HTTP_UPGRADE.str());
-	pHttpResponse_->add(HTTP_SEC_WEBSOCKET_ACCEPT, getWebsocketAcceptKey(pHttpRequest_->get(HTTP_SEC_WEBSOCKET_KEY)));
+	pHttpResponse_->add(HTTP_SEC_WEBSOCKET_ACCEPT, getWebsocketAcceptKey(pHttpRequest_->get(HTTP_SEC_WEBSOCKET_KEY).c_str()));
 	pHttpResponse_->add(HTTP_CONETNT_LENGTH, 0);
 
 	std::string protocol;
 	if (pHttpRequest_->has(HTTP_SEC_WEBSOCKET_PROTOCOL)) {
-		protocol = pHttpRequest_->get(HTTP_SEC_WEBSOCKET_PROTOCOL);
+		protocol = pHttpRequest_->get(HTTP_SEC_WEBSOCKET_PROTOCOL).c_str();
 		pHttpResponse_->add(HTTP_SEC_WEBSOCKET_PROTOCOL, static_cast<std::string const &>(protocol));
 	}
 
@@ -212,14 +239,17 @@ void HttpContext::sendSwitchToWebSocketMessage(rapid::ConnectionPtr &pConn) {
 
 	// Setup WebSocket service
 
+	// The upgrade request is the last HTTP/1.x request, sendMessage is not reached to stop its deadlines.
+	stopRequestDeadlines(pConn);
 	hasUpgraded_ = true;
+	useRingReceiveBuffer(pConn);
 	
 	pWebSocketService_ = WebSocketService::createService(protocol);
 
 	auto pWebSocketDispatcher = std::make_shared<MessageDispatcher<WebSocketRequest>>();
 	
 	pWebSocketDispatcher->addMessageEventHandler(WS_MESSAGE,
-		[this](rapid::ConnectionPtr &conn, WebSocketRequestPtr pWebSocketRequest) {
+		[this](rapid::ConnectionHandle &conn, WebSocketRequestPtr pWebSocketRequest) {
 		pWebSocketRequest_ = pWebSocketRequest;
 		onWebSocketMessage(conn);
 	});
@@ -228,7 +258,7 @@ void HttpContext::sendSwitchToWebSocketMessage(rapid::ConnectionPtr &pConn) {
 	auto pContext = shared_from_this();
 
 	// Set handler to read WebSocket data
-	pConn->setSendEventHandler([this, pContext](rapid::ConnectionPtr conn) {
+	pConn->setSendEventHandler([this, pContext](rapid::ConnectionHandle conn) {
 		pWebSocketService_->onOpen(conn, pContext);
 		readLoop(conn);
 	});
@@ -239,7 +269,7 @@ void HttpContext::sendSwitchToWebSocketMessage(rapid::ConnectionPtr &pConn) {
 	}
 }
 
-void HttpContext::onWebSocketMessage(rapid::ConnectionPtr &pConn) {
+void HttpContext::onWebSocketMessage(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	if (pWebSocketService_->onMessage(pConn, pWebSocketRequest_)) {
@@ -247,11 +277,15 @@ void HttpContext::onWebSocketMessage(rapid::ConnectionPtr &pConn) {
 	}
 }
 
-void HttpContext::onDisconnect(rapid::ConnectionPtr &pConn) {
+void HttpContext::onDisconnect(rapid::ConnectionHandle &pConn) {
 	RAPID_TRACE_CALL();
 
 	if (pWebSocketService_ != nullptr) {
 		pWebSocketService_->onClose(pConn);
 		pWebSocketService_.reset();
 	}
+
+	// The context goes back to the pool, the next connection starts as HTTP/1.x.
+	hasUpgraded_ = false;
+	isReadingRequest_ = false;
 }
@@ -18,44 +18,50 @@ public:
 
 	virtual ~HttpContext();
 
-	virtual void handshake(rapid::ConnectionPtr &pConn);
+	virtual void handshake(rapid::ConnectionHandle &pConn);
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn);
+	virtual void readLoop(rapid::ConnectionHandle &pConn);
 
-	virtual void sendMessage(rapid::ConnectionPtr &pConn);
+	virtual void sendMessage(rapid::ConnectionHandle &pConn);
 
-	virtual void onDisconnect(rapid::ConnectionPtr &pConn);
+	virtual void onDisconnect(rapid::ConnectionHandle &pConn);
 
 	void setId(size_t id) noexcept;
 
 	size_t id() const noexcept;
 
 protected:
-	void onAcceptConnection(rapid::ConnectionPtr &pConn);
+	void onAcceptConnection(rapid::ConnectionHandle &pConn);
 
-	void readPostData(rapid::ConnectionPtr &pConn);
+	void readPostData(rapid::ConnectionHandle &pConn);
+
+	// Header read and request deadlines of a HTTP/1.x request, started by its first bytes.
+	void startRequestDeadlines(rapid::ConnectionHandle &pConn);
+
+	void stopRequestDeadlines(rapid::ConnectionHandle &pConn);
 
 	// Switch to protocol handler
 
-	void sendSwitchToHttp2cMessage(rapid::ConnectionPtr &pConn);
+	void sendSwitchToHttp2cMessage(rapid::ConnectionHandle &pConn);
 
-	void sendSwitchToWebSocketMessage(rapid::ConnectionPtr &pConn);
+	void sendSwitchToWebSocketMessage(rapid::ConnectionHandle &pConn);
 
 	// HTTP message handler
 
-	void onHttpGetMessage(rapid::ConnectionPtr &pConn);
+	void onHttpGetMessage(rapid::ConnectionHandle &pConn);
 
-	void onHttpPostMessage(rapid::ConnectionPtr &pConn);
+	void onHttpPostMessage(rapid::ConnectionHandle &pConn);
 
 	// WebSocket message handler
 
-	void onWebSocketMessage(rapid::ConnectionPtr &pConn);
+	void onWebSocketMessage(rapid::ConnectionHandle &pConn);
 
 private:
 	void setEventHandler();
 
 protected:
 	volatile bool hasUpgraded_ : 1;
+	bool isReadingRequest_;
 	size_t id_;
 	std::unique_ptr<HttpCodec> pHttpCodec_;
 	WebSocketServicePtr pWebSocketService_;
@@ -3,6 +3,8 @@
 // More license information, please see LICENSE file in module root folder.
 //---------------------------------------------------------------------------------------------------------------------
 
+#include <cstdio>
+
 #include <rapid/utils/singleton.h>
 
 #include "httpserverconfigfacade.h"
@@ -27,17 +29,17 @@ HttpHeaders::HttpHeaders() {
 HttpHeaders::~HttpHeaders() {	
 }
 
-void HttpHeaders::add(std::string const &name, char const *value, uint32_t valueLength) {
-	auto indexedName = HttpServerConfigFacade::getInstance().getHeadersTable().getIndexedName(name);
+void HttpHeaders::add(char const *name, uint32_t nameLength, char const *value, uint32_t valueLength) {
+	auto indexedName = HttpServerConfigFacade::getInstance().getHeadersTable().getIndexedName(name, nameLength);
 	if (!indexedName.second) {
 		return;
 	}
 	headerNames_.push_back(indexedName);
-	headerValues_.emplace_back(value, valueLength);
+	headerValues_.emplace_back(value, valueLength, rapid::utils::ArenaAllocator<char>(&arena_));
 }
 
-std::string const& HttpHeaders::get(HttpHeaderName const &header) const {
-	static std::string const EMPTY_STRING;
+HttpHeaderValue const& HttpHeaders::get(HttpHeaderName const &header) const {
+	static HttpHeaderValue const EMPTY_STRING;
 
 	auto numHeaderNames = static_cast<uint32_t>(headerNames_.size());
 	for (uint32_t i = 0; i < numHeaderNames; ++i) {
@@ -48,13 +50,15 @@ std::string const& HttpHeaders::get(HttpHeaderName const &header) const {
 	return EMPTY_STRING;
 }
 
-void HttpHeaders::add(HttpHeaderName const &header, std::string const &value) {
+void HttpHeaders::add(HttpHeaderName const &header, char const *value, uint32_t valueLength) {
 	headerNames_.push_back(std::make_pair(header.hash(), &header.str()));
-	headerValues_.emplace_back(value.c_str(), value.length());
+	headerValues_.emplace_back(value, valueLength, rapid::utils::ArenaAllocator<char>(&arena_));
 }
 
 void HttpHeaders::add(HttpHeaderName const& name, int64_t value) {
-	add(name, std::to_string(value));
+	char buffer[24];
+	auto const length = std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value));
+	add(name, buffer, static_cast<uint32_t>(length));
 }
 
 void HttpHeaders::remove(HttpHeaderName const& header) {
@@ -70,6 +74,8 @@ void HttpHeaders::remove(HttpHeaderName const& header) {
 
 void HttpHeaders::clear() {
 	headerNames_.clear();
+	// Values must be gone before the arena hands their storage out again.
 	headerValues_.clear();
+	arena_.reset();
 }
 
@@ -8,6 +8,8 @@
 #include <string>
 #include <vector>
 
+#include <rapid/utils/monotonicarena.h>
+
 enum HeaderCode {
 	HTTP_HEADER_ACCEPT = 0,
 	HTTP_HEADER_ACCEPT_CHARSET,
@@ -114,23 +116,33 @@ private:
 	uint32_t hash_;
 };
 
+// Header values live in a per-message arena which clear() rewinds at the request boundary.
+using HttpHeaderValue = rapid::utils::ArenaString;
+
 class HttpHeaders {
 public:
 	HttpHeaders();
 	
 	~HttpHeaders();
 
-	std::string const& get(HttpHeaderName const &header) const;
+	HttpHeaders(HttpHeaders const &) = delete;
+	HttpHeaders& operator=(HttpHeaders const &) = delete;
+
+	HttpHeaderValue const& get(HttpHeaderName const &header) const;
+
+	void add(HttpHeaderName const &header, std::string const &value) {
+		add(header, value.c_str(), static_cast<uint32_t>(value.length()));
+	}
 
-	void add(HttpHeaderName const &header, std::string const &value);
+	void add(HttpHeaderName const &header, char const *value, uint32_t valueLength);
 
 	void add(HttpHeaderName const &name, int64_t value);
 
 	void add(std::string const &name, std::string const &value) {
-		add(name, value.c_str(), static_cast<uint32_t>(value.length()));
+		add(name.c_str(), static_cast<uint32_t>(name.length()), value.c_str(), static_cast<uint32_t>(value.length()));
 	}
 
-	void add(std::string const &name, char const *value, uint32_t valueLength);
+	void add(char const *name, uint32_t nameLength, char const *value, uint32_t valueLength);
 	
 	bool has(HttpHeaderName const &header) const noexcept;
 
@@ -147,8 +159,9 @@ public:
 	}
 
 private:
+	rapid::utils::MonotonicArena arena_;
 	std::vector<std::pair<uint32_t, std::string const *>> headerNames_;
-	std::vector<std::string> headerValues_;
+	std::vector<HttpHeaderValue> headerValues_;
 };
 
 __forceinline bool HttpHeaders::has(HttpHeaderName const& header) const noexcept {
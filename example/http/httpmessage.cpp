@@ -3,6 +3,8 @@
 // More license information, please see LICENSE file in module root folder.
 //---------------------------------------------------------------------------------------------------------------------
 
+#include <cctype>
+#include <cstring>
 #include <filesystem>
 #include <sstream>
 #include <unordered_map>
@@ -40,10 +42,10 @@ static inline std::string getFileExt(std::string const &filePath) {
 }
 
 void HttpMessage::doSerialize(rapid::IoBuffer* pBuffer) {
-	headers_.foreach([pBuffer](std::string const &name, std::string const &value) {
+	headers_.foreach([pBuffer](std::string const &name, HttpHeaderValue const &value) {
 		pBuffer->append(name)
 			.append(':')
-			.append(value)
+			.append(value.c_str(), static_cast<uint32_t>(value.length()))
 			.append(HTTP_CRLF);
 	});
 	pBuffer->append(HTTP_CRLF);
@@ -70,7 +72,7 @@ void HttpRequest::setUri(char const *str, size_t length) {
 	uri_.fromString(str, length);
 }
 
-std::string HttpRequest::method() const {
+std::string const & HttpRequest::method() const {
     return method_;
 }
 
@@ -78,8 +80,13 @@ void HttpRequest::setMethod(std::string const &str) {
 	method_ = str;
 }
 
+void HttpRequest::setMethod(char const *str, size_t length) {
+	// Reuses the capacity of the previous request on this connection.
+	method_.assign(str, length);
+}
+
 uint64_t HttpRequest::getContentLength() const {
-    auto const value = get(HTTP_CONETNT_LENGTH);
+    auto const &value = get(HTTP_CONETNT_LENGTH);
     return std::strtoull(value.c_str(), nullptr, 10);
 }
 
@@ -96,22 +103,22 @@ void HttpRequest::createTempFile() {
 
 	// Initial multipart reader.
 	if (has(HTTP_CONETNT_TYPE)) {
-		auto contentType = get(HTTP_CONETNT_TYPE);
+		auto const &contentType = get(HTTP_CONETNT_TYPE);
 
-		if (contentType.find(HTTP_MULTIPART_FORM_DATA) != std::string::npos) {
-		} else if (contentType.find(HTTP_APP_X_WWW_FORM_URLENCODED) != std::string::npos) {
+		if (contentType.find(HTTP_MULTIPART_FORM_DATA.c_str()) != HttpHeaderValue::npos) {
+		} else if (contentType.find(HTTP_APP_X_WWW_FORM_URLENCODED.c_str()) != HttpHeaderValue::npos) {
 			// TODO: Implement this method.
 			throw NotImplementedException();
 		} else {
 			throw MalformedDataException();
 		}
 
-		auto pos = contentType.find(HTTP_BOUNDARY_EQ);
-		if (pos == std::string::npos) {
+		auto pos = contentType.find(HTTP_BOUNDARY_EQ.c_str());
+		if (pos == HttpHeaderValue::npos) {
 			throw MalformedDataException();
 		}
 
-		auto boundary = contentType.substr(pos + HTTP_BOUNDARY_EQ.length());
+		std::string boundary(contentType.c_str() + pos + HTTP_BOUNDARY_EQ.length());
 		multipartReader_.reset();
 		multipartReader_.setBoundary(boundary);
 		multipartReader_.onPartData = partDataCallback;
@@ -128,7 +135,7 @@ void HttpRequest::closePostFile() {
     postFile_.close();
 }
 
-bool HttpRequest::writeTempFile(rapid::ConnectionPtr pConn) {
+bool HttpRequest::writeTempFile(rapid::ConnectionHandle pConn) {
 	auto *pBuffer = pConn->getReceiveBuffer();
 	auto totalContentLength = getContentLength();
 
@@ -160,7 +167,7 @@ bool HttpRequest::isKeepAlive() const {
 	if (!has(HTTP_CONNECTION)) {
 		return true;
 	}
-	return rapid::utils::caseInsensitiveCompare(get(HTTP_CONNECTION), "keep-alive");
+	return rapid::utils::caseInsensitiveCompare(get(HTTP_CONNECTION).c_str(), "keep-alive") == 0;
 }
 
 bool HttpRequest::isRangeRequest() const {
@@ -168,25 +175,28 @@ bool HttpRequest::isRangeRequest() const {
 }
 
 void HttpRequest::getByteRange(int64_t &start, int64_t &end) const {
-	auto range = get(HTTP_RANGE);
+	static size_t const BYTES_PREFIX_LENGTH = std::strlen("bytes=");
 
-	range = range.substr(std::string("bytes=").length());
-	auto pos = range.find("-");
-	auto rangeStart = range.substr(0, pos);
-	
-	std::string rangeEnd;
-	if (pos != std::string::npos) {
-		rangeEnd = range.substr(pos + 1);
+	auto const &range = get(HTTP_RANGE);
+	if (range.length() < BYTES_PREFIX_LENGTH) {
+		throw MalformedDataException();
 	}
 
-	rapid::utils::trim(rangeStart);
-	rapid::utils::trim(rangeEnd);
-	if (!rangeStart.empty()) {
-		start = std::strtoll(rangeStart.c_str(), nullptr, 10);
-	}
+	// Parse in place, "bytes=100-" and "bytes=-100" leave the missing bound untouched.
+	auto parseBound = [](char const *str, int64_t &bound) {
+		while (*str == ' ') {
+			++str;
+		}
+		if (std::isdigit(static_cast<unsigned char>(*str))) {
+			bound = std::strtoll(str, nullptr, 10);
+		}
+	};
 
-	if (!rangeEnd.empty()) {
-		end = std::strtoll(rangeEnd.c_str(), nullptr, 10);
+	parseBound(range.c_str() + BYTES_PREFIX_LENGTH, start);
+
+	auto pos = range.find('-', BYTES_PREFIX_LENGTH);
+	if (pos != HttpHeaderValue::npos) {
+		parseBound(range.c_str() + pos + 1, end);
 	}
 }
 
@@ -198,16 +208,16 @@ bool HttpRequest::isWebSocketUpgradeRequest() const {
 	if (has(HTTP_SEC_WEBSOCKET_KEY)
 		&& has(HTTP_SEC_WEBSOCKET_VERSION)
 		&& has(HTTP_CONNECTION)) {
-		auto connection = get(HTTP_CONNECTION);
-		auto upgrade = get(HTTP_UPGRADE);
-		return connection.find("Upgrade") != std::string::npos
-			&& upgrade.find(HTTP_WEBSOCKET.str()) != std::string::npos;
+		auto const &connection = get(HTTP_CONNECTION);
+		auto const &upgrade = get(HTTP_UPGRADE);
+		return connection.find("Upgrade") != HttpHeaderValue::npos
+			&& upgrade.find(HTTP_WEBSOCKET.str().c_str()) != HttpHeaderValue::npos;
 	}
 	return false;
 }
 
 bool HttpRequest::isHttp2UpgradeRequest() const {
-	return rapid::utils::caseInsensitiveCompare(get(HTTP_UPGRADE), HTTP_2_0);
+	return rapid::utils::caseInsensitiveCompare(get(HTTP_UPGRADE).c_str(), HTTP_2_0.c_str()) == 0;
 }
 
 void HttpRequest::partDataCallback(const char* buffer, size_t size, void* userData) {
@@ -222,6 +232,7 @@ HttpResponse::HttpResponse()
     , status_("200 OK")
 	, statusCode_(HTTP_OK)
 	, numberOfBytesToWrite_(0)
+	, contentOffset_(0)
 	, contentLength_(0) {
 }
 
@@ -253,7 +264,7 @@ HttpStatusCode HttpResponse::statusCode() const noexcept {
 	return statusCode_;
 }
 
-bool HttpResponse::sendStatusPage(rapid::ConnectionPtr &pConn, HttpStatusCode code, HttpRequestPtr httpRequest) {
+bool HttpResponse::sendStatusPage(rapid::ConnectionHandle &pConn, HttpStatusCode code, HttpRequestPtr httpRequest) {
 	auto pSendBuffer = pConn->getSendBuffer();
 	std::ostringstream ostr;
 	ostr << HttpServerConfigFacade::getInstance().getRootPath() << "/" << static_cast<uint16_t>(code) << ".html";
@@ -298,6 +309,7 @@ void HttpResponse::setRangeResponseHeader(HttpRequestPtr httpRequest) {
 		end = pFileReader_->getFileSize() - 1;
 	}
 	
+	contentOffset_ = start;
 	contentLength_ = end + 1 - start;
 	setContentRange(start, end, pFileReader_->getFileSize());
 	pFileReader_->seekTo(start);
@@ -320,6 +332,7 @@ void HttpResponse::setResponseHeader() {
 		numberOfBytesToWrite_ = 0;
 		contentLength_ = 0;
 	}
+	contentOffset_ = 0;
 
 	remove(HTTP_CONETNT_RANGE);
 	setContentLength(contentLength_);
@@ -368,17 +381,18 @@ void HttpResponse::wirteToBuffer(rapid::IoBuffer *pSendBuffer, std::string const
 
 void HttpResponse::writeErrorResponseHeader(rapid::IoBuffer *pSendBuffer, HttpStatusCode errorCode) {
 	numberOfBytesToWrite_ = 0;
+	contentOffset_ = 0;
 	contentLength_ = 0;
 	setStatusCode(errorCode);
 	setContentLength(0);
 	serialize(pSendBuffer);
 }
 
-void HttpResponse::writeResponseHeader(rapid::ConnectionPtr &pConn, rapid::IoBuffer* pSendBuffer, HttpRequestPtr httpRequest) {
+void HttpResponse::writeResponseHeader(rapid::ConnectionHandle &pConn, rapid::IoBuffer* pSendBuffer, HttpRequestPtr httpRequest) {
 	add(HTTP_SERVER, HttpServerConfigFacade::getInstance().getServerName());
 	/*
 	if (!httpRequest->has(HTTP_HOST) 
-		|| httpRequest->get(HTTP_HOST) != HttpServerConfigFacade::getInstance().getHost()) {
+		|| HttpServerConfigFacade::getInstance().getHost() != httpRequest->get(HTTP_HOST).c_str()) {
 		writeErrorResponseHeader(pSendBuffer, HTTP_BAD_REQUEST);
 	}
 	*/
@@ -402,21 +416,71 @@ void HttpResponse::writeResponseHeader(rapid::ConnectionPtr &pConn, rapid::IoBuf
 	state_ = SEND_HTTP_CONTENT;
 }
 
-bool HttpResponse::send(rapid::ConnectionPtr &pConn, HttpRequestPtr httpRequest) {
+bool HttpResponse::send(rapid::ConnectionHandle &pConn, HttpRequestPtr httpRequest) {
 	auto pSendBuffer = pConn->getSendBuffer();
 	setBufferLength(pSendBuffer->goodSize());
 
 	switch (state_) {
 	case SEND_HTTP_HEADER:
 		writeResponseHeader(pConn, pSendBuffer, httpRequest);
+		if (state_ == SEND_HTTP_CONTENT && canTransmitFile()) {
+			// The response header goes out as the head of the TransmitFile call.
+			return transmitContent(pConn);
+		}
+		if (state_ == SEND_HTTP_CONTENT && canEnqueueContent()) {
+			// The response header goes out in the same gather write as the content.
+			return enqueueContent(pConn);
+		}
 		break;
 	case SEND_HTTP_CONTENT:
+		if (canTransmitFile()) {
+			return transmitContent(pConn);
+		}
+		if (canEnqueueContent()) {
+			return enqueueContent(pConn);
+		}
 		return writeContent(pSendBuffer);
 		break;
+	case SEND_HTTP_CONTENT_TRANSMITTED:
+		return true;
+		break;
 	}
 	return false;
 }
 
+bool HttpResponse::canTransmitFile() const {
+	// HTTPs needs to encrypt the content in user space.
+	if (HttpServerConfigFacade::getInstance().isUseSSL()) {
+		return false;
+	}
+	return contentLength_ > 0 && pFileReader_->getFileHandle() != INVALID_HANDLE_VALUE;
+}
+
+bool HttpResponse::canEnqueueContent() const {
+	// HTTPs needs to encrypt the content in user space.
+	if (HttpServerConfigFacade::getInstance().isUseSSL()) {
+		return false;
+	}
+	return contentLength_ > 0
+		&& contentLength_ <= UINT32_MAX
+		&& !pFileReader_->getSlice().isEmpty();
+}
+
+bool HttpResponse::enqueueContent(rapid::ConnectionHandle &pConn) {
+	RAPID_TRACE_CALL();
+	state_ = SEND_HTTP_CONTENT_TRANSMITTED;
+	// Sent straight from the file cache, shared with every other response of the same file.
+	pConn->enqueueSend(pFileReader_->getSlice().slice(static_cast<uint32_t>(contentOffset_),
+		static_cast<uint32_t>(contentLength_)));
+	return pConn->sendAsync();
+}
+
+bool HttpResponse::transmitContent(rapid::ConnectionHandle &pConn) {
+	RAPID_TRACE_CALL();
+	state_ = SEND_HTTP_CONTENT_TRANSMITTED;
+	return pConn->sendFile(pFileReader_->getFileHandle(), contentOffset_, contentLength_);
+}
+
 bool HttpResponse::writeContent(rapid::IoBuffer *pSendBuffer) {
 	RAPID_TRACE_CALL();
 	state_ = SEND_HTTP_CONTENT;
@@ -30,15 +30,19 @@ public:
 		headers_.add(header, value);
 	}
 
+	void add(char const *name, uint32_t nameLength, char const *value, uint32_t valueLength) {
+		headers_.add(name, nameLength, value, valueLength);
+	}
+
 	void add(HttpHeaderName const &header, int64_t value) {
-		headers_.add(header, std::to_string(value));
+		headers_.add(header, value);
 	}
 
 	void remove(HttpHeaderName const &header) {
 		headers_.remove(header);
 	}
 
-	std::string const & get(HttpHeaderName const &header) const {
+	HttpHeaderValue const & get(HttpHeaderName const &header) const {
 		auto const& value = headers_.get(header);
 		if (!value.empty()) {
 			return value;
@@ -53,7 +57,7 @@ public:
 	bool has(HttpHeaderName const &header) const noexcept;
 
 	friend std::ostream& operator<<(std::ostream &ostr, HttpMessage const &message) {
-		message.headers_.foreach([&](std::string const &name, std::string const &value) {
+		message.headers_.foreach([&](std::string const &name, HttpHeaderValue const &value) {
 			ostr << name << ": " << value << "\n";
 		});
 		return ostr;
@@ -85,10 +89,12 @@ public:
 
     void setUri(std::string const &str);
 
-    std::string method() const;
+    std::string const & method() const;
 
     void setMethod(std::string const &str);
 
+	void setMethod(char const *str, size_t length);
+
 	void setUri(char const *str, size_t length);
 
     uint64_t getContentLength() const;
@@ -97,7 +103,7 @@ public:
 
     void closePostFile();
 
-    bool writeTempFile(rapid::ConnectionPtr pConn);
+    bool writeTempFile(rapid::ConnectionHandle pConn);
 
     void setKeepAlive();
 
@@ -137,6 +143,7 @@ public:
     enum SendState {
         SEND_HTTP_HEADER,
         SEND_HTTP_CONTENT,
+        SEND_HTTP_CONTENT_TRANSMITTED,
     };
 
     HttpResponse();
@@ -153,11 +160,11 @@ public:
 
 	void writeErrorResponseHeader(rapid::IoBuffer *pSendBuffer, HttpStatusCode errorCode);
 
-	bool sendStatusPage(rapid::ConnectionPtr &pConn, HttpStatusCode code, HttpRequestPtr httpRequest);
+	bool sendStatusPage(rapid::ConnectionHandle &pConn, HttpStatusCode code, HttpRequestPtr httpRequest);
 
-	virtual bool send(rapid::ConnectionPtr &pConn, HttpRequestPtr httpRequest);
+	virtual bool send(rapid::ConnectionHandle &pConn, HttpRequestPtr httpRequest);
 
-	virtual void writeResponseHeader(rapid::ConnectionPtr &pConn, rapid::IoBuffer* pSendBuffer, HttpRequestPtr httpRequest);
+	virtual void writeResponseHeader(rapid::ConnectionHandle &pConn, rapid::IoBuffer* pSendBuffer, HttpRequestPtr httpRequest);
 
 	virtual bool writeContent(rapid::IoBuffer *pSendBuffer);
 
@@ -171,7 +178,16 @@ public:
 
 	uint32_t getBufferLength() const;
 
+protected:
+	virtual bool canTransmitFile() const;
+
+	virtual bool canEnqueueContent() const;
+
 private:
+	bool transmitContent(rapid::ConnectionHandle &pConn);
+
+	bool enqueueContent(rapid::ConnectionHandle &pConn);
+
 	void wirteToBuffer(rapid::IoBuffer *pSendBuffer, std::string const &filePath, HttpRequestPtr httpRequest);
 
 	virtual void doSerialize(rapid::IoBuffer *pBuffer) override;
@@ -189,6 +205,7 @@ private:
 	HttpStatusCode statusCode_;
 	HttpFileReaderPtr pFileReader_;
 	int64_t numberOfBytesToWrite_;
+	int64_t contentOffset_;
 	int64_t contentLength_;
 };
 
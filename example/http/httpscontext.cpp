@@ -17,7 +17,7 @@ HttpsContext::~HttpsContext() {
 
 }
 
-void HttpsContext::handshake(rapid::ConnectionPtr &pConn) {
+void HttpsContext::handshake(rapid::ConnectionHandle &pConn) {
 	auto pSource = pConn->getReceiveBuffer();
 	auto pDest = pConn->getSendBuffer();
 
@@ -36,12 +36,13 @@ void HttpsContext::handshake(rapid::ConnectionPtr &pConn) {
 	} while (pSource->readSome(pConn));
 }
 
-void HttpsContext::readLoop(rapid::ConnectionPtr &pConn) {
+void HttpsContext::readLoop(rapid::ConnectionHandle &pConn) {
 	uint32_t bytesToRead = 0;
 	auto pBuffer = pConn->getReceiveBuffer();
 
 	do {
 		if (!pBuffer->isEmpty()) {
+			startRequestDeadlines(pConn);
 			if (engine_.decrypt(pBuffer)) {
 				pHttpCodec_->readLoop(pConn, bytesToRead);
 				if (!bytesToRead) break; // Decode done!
@@ -50,7 +51,7 @@ void HttpsContext::readLoop(rapid::ConnectionPtr &pConn) {
 	} while (pBuffer->readSome(pConn));
 }
 
-void HttpsContext::sendMessage(rapid::ConnectionPtr &pConn) {
+void HttpsContext::sendMessage(rapid::ConnectionHandle &pConn) {
 	auto pBuffer = pConn->getSendBuffer();
 
 	while (!pHttpResponse_->send(pConn, pHttpRequest_)) {
@@ -62,10 +63,11 @@ void HttpsContext::sendMessage(rapid::ConnectionPtr &pConn) {
 
 	pHttpResponse_->reset();
 	pHttpRequest_->removeAll();
+	stopRequestDeadlines(pConn);
 	readLoop(pConn);
 }
 
-void HttpsContext::onDisconnect(rapid::ConnectionPtr &pConn) {
+void HttpsContext::onDisconnect(rapid::ConnectionHandle &pConn) {
 	engine_.reset();
 	HttpContext::onDisconnect(pConn);
 }
\ No newline at end of file
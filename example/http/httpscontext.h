@@ -14,13 +14,13 @@ public:
 
 	virtual ~HttpsContext();
 
-	virtual void handshake(rapid::ConnectionPtr &pConn) override;
+	virtual void handshake(rapid::ConnectionHandle &pConn) override;
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn) override;
+	virtual void readLoop(rapid::ConnectionHandle &pConn) override;
 
-	virtual void sendMessage(rapid::ConnectionPtr &pConn) override;
+	virtual void sendMessage(rapid::ConnectionHandle &pConn) override;
 
-	virtual void onDisconnect(rapid::ConnectionPtr &pConn) override;
+	virtual void onDisconnect(rapid::ConnectionHandle &pConn) override;
 private:
 	APLNProtocols selectedALPN_ : 1;
 	OpenSslEngine engine_;
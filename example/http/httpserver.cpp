@@ -33,11 +33,16 @@ void HttpServer::stop() {
 void HttpServer::start() {
 	RAPID_TRACE_CALL();
 
+	// Let the in-flight requests finish before the worker threads are stopped.
+	static auto constexpr DRAIN_TIMEOUT = 30000;
+
 	server_.setSocketPool(
 		HttpServerConfigFacade::getInstance().getInitalUserConnection(),
 		HttpServerConfigFacade::getInstance().getMaxUserConnection(), 
 		HttpServerConfigFacade::getInstance().getBufferSize());
 
+	server_.setBusyPollTime(HttpServerConfigFacade::getInstance().getBusyPollTime());
+
 	if (HttpServerConfigFacade::getInstance().isUseSSL()) {
 		// Lazy initial OpenSSL library
 		SSLInitializer::getInstance();
@@ -101,26 +106,38 @@ void HttpServer::start() {
 	RAPID_LOG_INFO() << "Press 'Ctrl+C' to stop";
 	std::unique_lock<std::mutex> lock(waitStopMutex_);
 	stopFlag_.wait(lock);
+	server_.drain(DRAIN_TIMEOUT);
 	server_.shutdown();
+
+	auto const requestPoolStats = HttpServerConfigFacade::getInstance().getHttpRequestPool().stats();
+	RAPID_LOG_INFO() << "Request pool hits: " << requestPoolStats.hits
+		<< ", depot hits: " << requestPoolStats.depotHits
+		<< ", misses: " << requestPoolStats.misses;
+
+	auto const responsePoolStats = HttpServerConfigFacade::getInstance().getHttpResponsePool().stats();
+	RAPID_LOG_INFO() << "Response pool hits: " << responsePoolStats.hits
+		<< ", depot hits: " << responsePoolStats.depotHits
+		<< ", misses: " << responsePoolStats.misses;
 }
 
 void HttpServer::onNewConnection(rapid::ConnectionPtr &pConn) {
-	pConn->setAcceptEventHandler([this](rapid::ConnectionPtr &conn) {
+	pConn->setTimeout(rapid::Connection::IDLE_DEADLINE, HttpServerConfigFacade::getInstance().getIdleTimeout());
+	pConn->setTimeout(rapid::Connection::HEADER_READ_DEADLINE, HttpServerConfigFacade::getInstance().getHeaderReadTimeout());
+	pConn->setTimeout(rapid::Connection::REQUEST_DEADLINE, HttpServerConfigFacade::getInstance().getRequestTimeout());
+
+	pConn->setAcceptEventHandler([this](rapid::ConnectionHandle &conn) {
 		auto const &remoteAddress = conn->getRemoteSocketAddress();
 		RAPID_LOG_TRACE() << "Accepted address: " << remoteAddress.toString();
 		auto pContext = insertHttpContext(remoteAddress.hash());
 		if (HttpServerConfigFacade::getInstance().isUseSSL()) {
-			conn->setSendEventHandler([pContext](rapid::ConnectionPtr &c) {
-				pContext->handshake(c);
-			});
-			conn->setReceiveEventHandler([pContext](rapid::ConnectionPtr &c) {
-				pContext->handshake(c);
-			});
+			// The context map keeps the context until the connection has been disconnected.
+			conn->setSendEventHandler<HttpContext, &HttpContext::handshake>(pContext.get());
+			conn->setReceiveEventHandler<HttpContext, &HttpContext::handshake>(pContext.get());
 		}
 		pContext->handshake(conn);
 	});
 
-	pConn->setDisconnectEventHandler([this](rapid::ConnectionPtr &conn) {
+	pConn->setDisconnectEventHandler([this](rapid::ConnectionHandle &conn) {
 		auto const &remoteAddress = conn->getRemoteSocketAddress();
 		RAPID_LOG_TRACE() << "Disconnect address: " << remoteAddress.toString();
 		auto pContext = removeHttpContext(remoteAddress.hash());
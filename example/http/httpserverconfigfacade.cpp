@@ -81,7 +81,11 @@ HttpServerConfigFacade::HttpServerConfigFacade()
 	, numaNode_(0)
 	, bufferSize_(0)
 	, maxUserConnection_(0)
-	, initialUserConnection_(0) {
+	, initialUserConnection_(0)
+	, idleTimeout_(0)
+	, busyPollTime_(0)
+	, headerReadTimeout_(0)
+	, requestTimeout_(0) {
 }
 
 HttpServerConfigFacade::~HttpServerConfigFacade() {
@@ -104,6 +108,10 @@ void HttpServerConfigFacade::loadConfiguration(std::string const &filePath) {
 		maxUserConnection_ = std::strtoul(tcpSettings["MaxUserConnection"].c_str(), nullptr, 10);
 		bufferSize_ = SIZE_128KB;
 		numaNode_ = std::strtoul(tcpSettings["NumaNode"].c_str(), nullptr, 10);
+		// Milliseconds, a missing setting disables the timeout.
+		idleTimeout_ = std::strtoul(tcpSettings["IdleTimeout"].c_str(), nullptr, 10);
+		// Microseconds the IO threads busy poll before blocking, a missing setting disables it.
+		busyPollTime_ = std::strtoul(tcpSettings["BusyPollTime"].c_str(), nullptr, 10);
 	}
 
 	std::map<std::string, std::string> httpSettings;
@@ -118,6 +126,8 @@ void HttpServerConfigFacade::loadConfiguration(std::string const &filePath) {
 		tempFilePath_ = httpSettings["TempFilePath"];
 		rootPath_ = httpSettings["RootPath"];
 		indexFileName_ = httpSettings["IndexFileName"];
+		headerReadTimeout_ = std::strtoul(httpSettings["HeaderReadTimeout"].c_str(), nullptr, 10);
+		requestTimeout_ = std::strtoul(httpSettings["RequestTimeout"].c_str(), nullptr, 10);
 	}
 
 	std::map<std::string, std::string> sslSettings;
@@ -98,6 +98,14 @@ public:
 
 	uint16_t getNumaNode() const noexcept;
 
+	uint32_t getIdleTimeout() const noexcept;
+
+	uint32_t getBusyPollTime() const noexcept;
+
+	uint32_t getHeaderReadTimeout() const noexcept;
+
+	uint32_t getRequestTimeout() const noexcept;
+
 private:
 	void reloadConfiguration(std::string const &filePath);
 
@@ -109,6 +117,10 @@ private:
 	uint32_t bufferSize_;
 	uint32_t maxUserConnection_;
 	uint32_t initialUserConnection_;
+	uint32_t idleTimeout_;
+	uint32_t busyPollTime_;
+	uint32_t headerReadTimeout_;
+	uint32_t requestTimeout_;
 	std::string privateKeyFilePath_;
 	std::string certificateFilePath_;
 	std::string tempFilePath_;
@@ -187,4 +199,20 @@ __forceinline int HttpServerConfigFacade::getListenPort() const noexcept {
 
 __forceinline uint16_t HttpServerConfigFacade::getNumaNode() const noexcept {
 	return numaNode_;
+}
+
+__forceinline uint32_t HttpServerConfigFacade::getIdleTimeout() const noexcept {
+	return idleTimeout_;
+}
+
+__forceinline uint32_t HttpServerConfigFacade::getBusyPollTime() const noexcept {
+	return busyPollTime_;
+}
+
+__forceinline uint32_t HttpServerConfigFacade::getHeaderReadTimeout() const noexcept {
+	return headerReadTimeout_;
+}
+
+__forceinline uint32_t HttpServerConfigFacade::getRequestTimeout() const noexcept {
+	return requestTimeout_;
 }
\ No newline at end of file
@@ -26,17 +26,21 @@ HttpStaticHeaderTable::~HttpStaticHeaderTable() {
 }
 
 std::pair<uint32_t, std::string const*> HttpStaticHeaderTable::getIndexedName(std::string const& name) const {
-	auto hashValue = HttpStaticHeaderTable::hash(name);
-	return getIndexedName(hashValue, name);
+	return getIndexedName(name.c_str(), static_cast<uint32_t>(name.length()));
 }
 
-std::pair<uint32_t, std::string const*> HttpStaticHeaderTable::getIndexedName(uint32_t hashValue, std::string const& name) const {
+std::pair<uint32_t, std::string const*> HttpStaticHeaderTable::getIndexedName(char const *name, uint32_t nameLength) const {
+	auto hashValue = HttpStaticHeaderTable::hash(name, nameLength);
+	return getIndexedName(hashValue, name, nameLength);
+}
+
+std::pair<uint32_t, std::string const*> HttpStaticHeaderTable::getIndexedName(uint32_t hashValue, char const *name, uint32_t nameLength) const {
 	auto index = hashValue % HASH_TABLE_SIZE;
 	if (headerHashTable_[index].size() == 1) {
 		return std::pair<uint32_t, std::string const*>(hashValue, headerHashTable_[index][0].second.get());
 	}
 	for (auto const &header : headerHashTable_[index]) {
-		if ((*header.second) == name) {
+		if (header.second->compare(0, std::string::npos, name, nameLength) == 0) {
 			return std::pair<uint32_t, std::string const*>(hashValue, header.second.get());
 		}
 	}
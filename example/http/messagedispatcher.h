@@ -35,14 +35,14 @@ private:
 template <typename T>
 class MessageDispatcher {
 public:
-    using EventHandler = std::function<void(rapid::ConnectionPtr&, std::shared_ptr<T>)>;
+    using EventHandler = std::function<void(rapid::ConnectionHandle &, std::shared_ptr<T>)>;
 
 	MessageDispatcher() = default;
 
     MessageDispatcher(MessageDispatcher const &) = delete;
     MessageDispatcher& operator=(MessageDispatcher const &) = delete;
 
-	void onMessage(std::string const &name, rapid::ConnectionPtr &pConn, std::shared_ptr<T> pMsg);
+	void onMessage(std::string const &name, rapid::ConnectionHandle &pConn, std::shared_ptr<T> pMsg);
 
 	void addMessageEventHandler(std::string const &name, EventHandler &&handler);
 private:
@@ -50,7 +50,7 @@ private:
 };
 
 template <typename T>
-void MessageDispatcher<T>::onMessage(std::string const &name, rapid::ConnectionPtr &pConn, std::shared_ptr<T> pMsg) {
+void MessageDispatcher<T>::onMessage(std::string const &name, rapid::ConnectionHandle &pConn, std::shared_ptr<T> pMsg) {
 	auto itr = handlers_.find(name);
 	if (itr != handlers_.end()) {
 		(*itr).second(pConn, std::move(pMsg));
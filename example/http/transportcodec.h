@@ -9,7 +9,7 @@ public:
 	TransportCodec(TransportCodec const &) = delete;
 	TransportCodec& operator=(TransportCodec const &) = delete;
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn, size_t &bytesToRead) = 0;
+	virtual void readLoop(rapid::ConnectionHandle &pConn, size_t &bytesToRead) = 0;
 
 protected:
 	TransportCodec() = default;
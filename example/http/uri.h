@@ -28,11 +28,12 @@ public:
 	}
 
 	void fromString(char const *str, size_t length) {
-		if (length > buffer_.size()) {
+		// The buffer only grows, a keep-alive connection parses every later request in place.
+		if (length + 1 > buffer_.size()) {
 			buffer_.resize(length + 1);
 		}
-		memset(buffer_.data(), 0, buffer_.size());
 		memcpy(buffer_.data(), str, length);
+		buffer_[length] = '\0';
 		valid_ = http_parser_parse_url(buffer_.data(), length, 0, &parser_) == 0;
 	}
 
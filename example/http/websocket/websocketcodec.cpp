@@ -311,7 +311,7 @@ WebSocketCodec::WebSocketCodec(std::shared_ptr<MessageDispatcher<WebSocketReques
 	pWebSocketRequest_ = std::make_shared<WebSocketRequest>();
 }
 
-void WebSocketCodec::readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) {
+void WebSocketCodec::readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) {
 	RAPID_TRACE_CALL();
 
 	auto pBuffer = pConn->getReceiveBuffer();
@@ -120,7 +120,7 @@ public:
 	WebSocketCodec(WebSocketCodec const &) = delete;
 	WebSocketCodec& operator=(WebSocketCodec const &) = delete;
 
-	virtual void readLoop(rapid::ConnectionPtr &pConn, uint32_t &bytesToRead) override;
+	virtual void readLoop(rapid::ConnectionHandle &pConn, uint32_t &bytesToRead) override;
 private:
 	std::shared_ptr<MessageDispatcher<WebSocketRequest>> dispatcher_;
 	WebSocketFrameReader reader_;
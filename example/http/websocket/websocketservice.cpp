@@ -15,12 +15,12 @@
 #include <rapidjson/writer.h>
 
 #include <rapid/iobuffer.h>
+#include <rapid/ioslice.h>
 #include <rapid/platform/performancecounter.h>
 #include <rapid/platform/utils.h>
 #include <rapid/platform/spinlock.h>
 #include <rapid/logging/logging.h>
 #include <rapid/utils/mpmc_bounded_queue.h>
-#include <rapid/utils/threadpool.h>
 #include <rapid/utils/stopwatch.h>
 #include <rapid/details/timingwheel.h>
 #include <rapid/utils/stringutilis.h>
@@ -39,7 +39,7 @@ struct Message {
 		: messageId(-1) {
 	}
 
-	explicit Message(int id, std::string const &message)
+	explicit Message(int id, rapid::IoSlice const &message)
 		: messageId(id)
 		, content(message) {
 	}
@@ -50,7 +50,8 @@ struct Message {
 
 	int messageId;
 	rapid::utils::SystemStopwatch liveTime;
-	std::string content;
+	// Shared by every channel the message was pushed to.
+	rapid::IoSlice content;
 };
 
 const Message Message::EMPTY_MESSAGE;
@@ -81,7 +82,7 @@ public:
 		auto ret = messages_.erase(key);
 	}
 
-	void enqueue(std::string const &key, std::string const &message) {
+	void enqueue(std::string const &key, rapid::IoSlice const &message) {
 		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
 		auto id = makeUniqueMessageId();
 		if (!key.empty()) {
@@ -91,6 +92,11 @@ public:
 		}
 	}
 
+	bool isEmpty() const {
+		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
+		return messages_.empty();
+	}
+
 	Message getMessage() const {
 		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
 		for (auto const & message : messages_) {
@@ -142,13 +148,17 @@ public:
 		return channels_[channelName];
 	}
 
-	void pushMessage(std::string const &channelName, std::string const &key, std::string const &message) {
+	void pushMessage(std::string const &channelName, std::string const &key, rapid::IoSlice const &message) {
 		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
 		onStartupChannel(channelName);
 		channels_[channelName]->enqueue(key, message);
 		onActiveSubscribers(channelName);
 	}
 
+	void pushMessage(std::string const &channelName, std::string const &key, std::string const &message) {
+		pushMessage(channelName, key, rapid::IoSlice(message));
+	}
+
 	void pushMessage(std::string const &channelName, int key, std::string const &message) {
 		pushMessage(channelName, std::to_string(key), message);
 	}
@@ -224,10 +234,11 @@ public:
 			pushThread_.join();
 	}
 
-	void subscribe(std::string const &name, rapid::ConnectionPtr &pConn, int maxExpireSecs = INT_MAX) {
+	void subscribe(std::string const &name, rapid::ConnectionHandle &pConn, int maxExpireSecs = INT_MAX) {
 		RAPID_TRACE_CALL();
 		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
-		connlist_[name] = pConn;
+		// The handle does not own the connection, the list keeps it alive until unsubscribed.
+		connlist_[name] = pConn.share();
 		mananger_.addChannel(name, maxExpireSecs);
 	}
 
@@ -242,8 +253,10 @@ public:
 		RAPID_TRACE_CALL();
 		std::lock_guard<rapid::platform::Spinlock> guard{ lock_ };
 		auto subscribeList = getSubscribe();
+		// Copied once, every subscriber sends the same bytes.
+		rapid::IoSlice content(message);
 		for (auto const &subscribe : subscribeList) {
-			mananger_.pushMessage(subscribe, "", message);
+			mananger_.pushMessage(subscribe, "", content);
 		}
 	}
 
@@ -275,31 +288,41 @@ std::vector<std::string> MessagePusher::getSubscribe() {
 }
 
 void MessagePusher::pushMessageLoop() {
-	rapid::utils::ThreadPool threadPool;
-
 	while (!stopped_) {
-		bool isMessageEmpty = true;
-
 		if (auto lock = rapid::platform::tryToLock(lock_)) {
 			for (auto &user : connlist_) {
-				auto pBuffer = user.second->getSendBuffer();
-				if (!pBuffer->hasCompleted()) {
-					break;
+				auto name = user.first;
+				auto pPending = mananger_.getChannel(name);
+				if (pPending == nullptr || pPending->isEmpty()) {
+					continue;
 				}
+				// Posted tasks run between the IO completions of the connection, the send buffer is not
+				// written by its own handlers meanwhile.
+				user.second->postAsync([name, this](rapid::ConnectionHandle conn) {
+					auto pBuffer = conn->getSendBuffer();
+					if (!pBuffer->hasCompleted()) {
+						// Still sending, the message goes out in a later round.
+						return;
+					}
+
+					auto pChannel = mananger_.getChannel(name);
+					if (pChannel == nullptr) {
+						return;
+					}
 
-				threadPool.startNew([user, pBuffer, this]() {
-					auto message = mananger_.getChannel(user.first)->getMessage();
+					auto message = pChannel->getMessage();
 					if (message == Message::EMPTY_MESSAGE) {
 						return;
 					}
 
-					RAPID_LOG_TRACE() << "Send Message " << message.messageId << std::endl << message.content;
+					RAPID_LOG_TRACE() << "Send Message " << message.messageId << " (" << message.content.size() << " bytes)";
+					// Only the frame header is written per connection, the payload is queued by reference.
 					WebSocketResponse resp;
-					resp.setContentLength(message.content.length());
+					resp.setContentLength(message.content.size());
 					resp.serialize(pBuffer);
-					pBuffer->append(message.content);
-					mananger_.removeMessage(user.first, message.messageId);
-					user.second->sendAsync();
+					conn->enqueueSend(message.content);
+					mananger_.removeMessage(name, message.messageId);
+					conn->sendAsync();
 				});
 			}
 		}
@@ -391,10 +414,10 @@ public:
 	virtual ~WebSocketChatService() {
 	}
 
-	virtual void onOpen(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpContext> pContext) override {
+	virtual void onOpen(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpContext> pContext) override {
 		MessagePusher::getInstance().subscribe(std::to_string(uid_), pConn);
 
-		pConn->setSendEventHandler([pContext](rapid::ConnectionPtr &conn) {
+		pConn->setSendEventHandler([pContext](rapid::ConnectionHandle &conn) {
 			auto pBuffer = conn->getReceiveBuffer();
 			if (pBuffer->hasCompleted())
 				pContext->readLoop(conn);
@@ -403,7 +426,7 @@ public:
 		addUidMessage(uid_);
 	}
 
-	virtual bool onMessage(rapid::ConnectionPtr &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) override {
+	virtual bool onMessage(rapid::ConnectionHandle &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) override {
 		if (webSocketRequest->isClosed()) {
 			onClose(pConn);
 			return false;
@@ -424,7 +447,7 @@ public:
 		return pBuffer->isEmpty();
 	}
 
-	virtual void onClose(rapid::ConnectionPtr &pConn) override {
+	virtual void onClose(rapid::ConnectionHandle &pConn) override {
 		MessagePusher::getInstance().unSubscribe(username_);
 		removeUserlist(uid_);
 		updateUserlistMessage(getUserlist());
@@ -485,13 +508,13 @@ public:
 
 	}
 
-	virtual void onOpen(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpContext> pContext) override {
-		pConn->setSendEventHandler([pContext](rapid::ConnectionPtr &conn) {
+	virtual void onOpen(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpContext> pContext) override {
+		pConn->setSendEventHandler([pContext](rapid::ConnectionHandle &conn) {
 			pContext->readLoop(conn);
 		});
 	}
 
-	virtual bool onMessage(rapid::ConnectionPtr &pConn, std::shared_ptr<WebSocketRequest> pWebSocketRequest) override {
+	virtual bool onMessage(rapid::ConnectionHandle &pConn, std::shared_ptr<WebSocketRequest> pWebSocketRequest) override {
 		auto isSendCompleted = false;
 
 		auto pReceiveBuffer = pConn->getReceiveBuffer();
@@ -519,7 +542,7 @@ public:
 		return isSendCompleted;
 	}
 
-	virtual void onClose(rapid::ConnectionPtr &pConn) override {
+	virtual void onClose(rapid::ConnectionHandle &pConn) override {
 		/*
 		auto pSendBuffer = pConn->getSendBuffer();
 		WebSocketResponse resp;
@@ -571,10 +594,10 @@ public:
 	virtual ~WebSocketPerfmonService() {
 	}
 
-	virtual void onOpen(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpContext> pContext) override {
+	virtual void onOpen(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpContext> pContext) override {
 		pusher_.subscribe(std::to_string(uid_), pConn);
 
-		pConn->setSendEventHandler([pContext](rapid::ConnectionPtr &conn) {
+		pConn->setSendEventHandler([pContext](rapid::ConnectionHandle &conn) {
 			auto pBuffer = conn->getReceiveBuffer();
 			if (pBuffer->hasCompleted())
 				pContext->readLoop(conn);
@@ -586,7 +609,7 @@ public:
 		}, 1000);
 	}
 
-	virtual bool onMessage(rapid::ConnectionPtr &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) override {
+	virtual bool onMessage(rapid::ConnectionHandle &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) override {
 		if (webSocketRequest->isClosed()) {
 			auto pBuffer = pConn->getReceiveBuffer();
 			pBuffer->retrieve(webSocketRequest->contentLength());
@@ -597,7 +620,7 @@ public:
 		return true;
 	}
 
-	virtual void onClose(rapid::ConnectionPtr &pConn) override {
+	virtual void onClose(rapid::ConnectionHandle &pConn) override {
 		pusher_.unSubscribe(std::to_string(uid_));
 		pTimer_->stop();
 	}
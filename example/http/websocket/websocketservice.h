@@ -16,10 +16,10 @@ public:
 
 	static std::shared_ptr<WebSocketService> createService(std::string const &protocol);
 
-	virtual void onOpen(rapid::ConnectionPtr &pConn, std::shared_ptr<HttpContext> pContext) = 0;
+	virtual void onOpen(rapid::ConnectionHandle &pConn, std::shared_ptr<HttpContext> pContext) = 0;
 
-	virtual bool onMessage(rapid::ConnectionPtr &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) = 0;
+	virtual bool onMessage(rapid::ConnectionHandle &pConn, std::shared_ptr<WebSocketRequest> webSocketRequest) = 0;
 
-	virtual void onClose(rapid::ConnectionPtr &pConn) = 0;
+	virtual void onClose(rapid::ConnectionHandle &pConn) = 0;
 };
 
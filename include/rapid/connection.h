@@ -7,12 +7,21 @@
 
 #include <rapid/platform/platform.h>
 
+#include <mswsock.h>
+
 #include <rapid/eventhandler.h>
 
 #include <rapid/exception.h>
 #include <rapid/details/socket.h>
 #include <rapid/details/socketaddress.h>
 #include <rapid/details/ioflags.h>
+#include <rapid/details/sendqueue.h>
+#include <rapid/details/posttaskqueue.h>
+#include <rapid/details/strand.h>
+#include <rapid/details/deadlinewheel.h>
+
+#include <rapid/iobuffer.h>
+#include <rapid/ioslice.h>
 
 namespace rapid {
 
@@ -27,11 +36,10 @@ class TimingWheel;
 using TimingWheelPtr = std::shared_ptr<TimingWheel>;
 }
 
-class IoBuffer;
-
 class Connection : public OVERLAPPED, public std::enable_shared_from_this<Connection> {
 public:
-	Connection(details::TcpServerSocket *listenSocket,
+	Connection(details::IoEventDispatcher &dispatcher,
+		details::TcpServerSocket *listenSocket,
 		details::BlockFactory &factory,
 		details::TimingWheelPtr reuseTimingWheel);
 
@@ -40,15 +48,30 @@ public:
     Connection(Connection const &) = delete;
     Connection& operator=(Connection const &) = delete;
 
+	enum DeadlineType {
+		IDLE_DEADLINE,
+		HEADER_READ_DEADLINE,
+		REQUEST_DEADLINE,
+		MAX_DEADLINE_TYPE,
+	};
+
     bool acceptAsync();
 
+	// Connect an outbound connection (created without a listen socket) to remoteAddress with ConnectEx.
+	// Returns true if connected synchronously, otherwise the connect event handler is invoked with
+	// the result. A failed connection may be connected again.
+	bool connectAsync(details::SocketAddress const &remoteAddress);
+
 	void sendAndDisconnec();
 
     uint32_t getConnectTime() const;
 
     void cancelPendingRequest();
 
-	void postAsync(std::function<void(ConnectionPtr)> handler);
+	// Run handler on an IO thread of the connection, never at the same time as its IO completions, so
+	// the handler may use the buffers as an event handler does. Safe to call from any thread at the same
+	// time, tasks posted before an IO thread picks them up run in one batch in posting order.
+	void postAsync(std::function<void(ConnectionHandle)> handler);
 
     template <typename Lambda>
 	void setAcceptEventHandler(Lambda &&handler) {
@@ -70,6 +93,46 @@ public:
 		pDisconnectBuffer_->setCompleteHandler(std::move(handler));
     }
 
+	// Statically bound handlers, e.g. setReceiveEventHandler<HttpContext, &HttpContext::readLoop>(this).
+	// The member is called without going through a std::function, pObject must outlive the binding.
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	void setAcceptEventHandler(T *pObject) noexcept {
+		pAcceptBuffer_->setCompleteHandler<T, Handler>(pObject);
+	}
+
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	void setReceiveEventHandler(T *pObject) noexcept {
+		pReceiveBuffer_->setCompleteHandler<T, Handler>(pObject);
+	}
+
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	void setSendEventHandler(T *pObject) noexcept {
+		pSendBuffer_->setCompleteHandler<T, Handler>(pObject);
+	}
+
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	void setDisconnectEventHandler(T *pObject) noexcept {
+		pDisconnectBuffer_->setCompleteHandler<T, Handler>(pObject);
+	}
+
+	template <typename Lambda>
+	void setConnectEventHandler(Lambda &&handler) {
+		connectHandler_ = std::move(handler);
+	}
+
+	// Invoked when the socket of an outbound connection can be connected again, the TIME_WAIT delay
+	// has passed if it was closed actively. Accepted connections go back to acceptAsync instead.
+	template <typename Lambda>
+	void setReuseEventHandler(Lambda &&handler) {
+		reuseHandler_ = std::move(handler);
+	}
+
+	// Invoked once the pending send bytes have dropped to the low watermark after reaching the high one.
+	template <typename Lambda>
+	void setWritableEventHandler(Lambda &&handler) {
+		writableHandler_ = std::move(handler);
+	}
+
 	void onIoCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred);
 
     IoBuffer* getReceiveBuffer() const noexcept;
@@ -78,12 +141,83 @@ public:
 
 	bool sendAsync();
 
+	// Queue data to be sent after the bytes of the send buffer, both go out in one gather write.
+	// The memory must stay valid until it has been sent, pOwner is released at that point.
+	// Unlike the send buffer, segments may be queued while a send is pending.
+	void enqueueSend(char const *data, uint32_t length, std::shared_ptr<void const> pOwner = nullptr);
+
+	// Queue the bytes of the slice by reference, the slice keeps them alive until they have been sent.
+	void enqueueSend(IoSlice const &slice);
+
+	// Transmit length bytes of the file from offset, after the bytes of the send buffer, without copying
+	// them through user space. Ranges above SEND_FILE_MAX_SIZE go out in several TransmitFile calls.
+	// Same completion semantics as sendAsync: returns true if the whole range has been sent, otherwise
+	// the send event handler is invoked once it has. The handle must stay open until then.
+	bool sendFile(HANDLE fileHandle, uint64_t offset, uint64_t length);
+
+	// Bound the bytes waiting in the send buffer and the send queue. Once they reach highWatermark
+	// isWritable returns false and readSome stops posting receives, both are released when the
+	// bytes drop to lowWatermark. A highWatermark of 0 (the default) disables the check.
+	void setWriteWatermarks(uint32_t lowWatermark, uint32_t highWatermark);
+
+	bool isWritable() noexcept;
+
+	uint64_t getPendingSendBytes() const noexcept;
+
+	// Timeout in milliseconds of a deadline, 0 (the default) disables it. The idle deadline is started
+	// when the connection is established and restarted by every byte received or sent. The header read
+	// and request deadlines are started and cancelled by the protocol. An expired deadline aborts the
+	// pending IO and actively closes the connection on its IO thread, the socket is then reused.
+	void setTimeout(DeadlineType type, uint32_t timeout);
+
+	// Start the deadline from now, replacing the running one. Call it from the event handlers of the
+	// connection or while it has no IO pending.
+	void startDeadline(DeadlineType type);
+
+	void cancelDeadline(DeadlineType type);
+
+	// Stop reusing the socket and close the connection once it has no request in progress: an idle
+	// connection is closed at once, a busy one when it next reads with nothing buffered or pending to
+	// send. A started request deadline marks a request in progress even if its timeout is 0.
+	// drainedHandler is invoked on an IO thread once the socket has been closed or was not connected.
+	void drain(std::function<void(ConnectionHandle&)> drainedHandler);
+
+	// Cancel the pending AcceptEx to take a surplus socket out of the pool. retiredHandler is invoked
+	// on an IO thread once it has been cancelled. If a connection was accepted meanwhile the socket is
+	// kept as any other connection and keptHandler is invoked instead, before the accept handler.
+	void retire(std::function<void(ConnectionHandle&)> retiredHandler, std::function<void(ConnectionHandle&)> keptHandler);
+
+	// Decommit the buffer pages grown beyond the first one while the socket waits in the pool for a
+	// connection, otherwise do nothing. Safe to call from any thread, returns true if pages were freed.
+	bool reclaimBuffers();
+
+	// Abort the pending IO and actively close the connection on its IO thread to give its buffer pages
+	// back under memory pressure. Nothing happens if it is not established anymore.
+	void shed();
+
+	// Bytes committed by the receive and send buffers. The buffers charge an atomic counter as they grow
+	// and shrink, so the pool controller may read it from its thread.
+	uint64_t getBufferSize() const noexcept;
+
+	// Accepts completed on this socket. Both are atomic so the pool controller may read them from its thread.
+	uint64_t getAcceptCount() const noexcept;
+
+	bool isAcceptPending() const noexcept;
+
 	details::SocketAddress const & getRemoteSocketAddress() const noexcept;
 
 	details::SocketAddress const & getLocalSocketAddress() const noexcept;
 
+	details::IoEventDispatcher & getIoEventDispatcher() const noexcept;
+
+	// The handle passed to the event handlers, see ConnectionHandle.
+	ConnectionHandle handle() noexcept;
+
 private:
 	friend class IoBuffer;
+	friend class details::DeadlineWheel;
+
+	static uint32_t constexpr MAX_SEND_IOVEC_COUNT = 64;
 
 	struct AcceptBufferSize {
 		static uint32_t constexpr localAddrLen = sizeof(SOCKADDR_STORAGE);
@@ -101,14 +235,55 @@ private:
 
 	bool receiveAsync(WSABUF * __restrict iovec, uint32_t numIovec, IoBuffer * __restrict pBuffer, uint32_t * __restrict numByteRecv);
 
-	bool sendFileAsync(HANDLE fileHandle, uint64_t offset = 0, uint32_t numberOfBytesToWrite = 0);
+	bool sendFileAsync(HANDLE fileHandle, uint64_t offset, uint32_t numberOfBytesToWrite, IoBuffer * __restrict pBuffer, uint32_t * __restrict numByteSend);
 
 	bool sendAsync(char const * __restrict buffer, uint32_t bufferLen, IoBuffer * __restrict pBuffer, uint32_t * __restrict numByteSend);
 
 	bool sendAsync(WSABUF * __restrict iovec, uint32_t numIovec, IoBuffer * __restrict pBuffer, uint32_t * __restrict numByteSend);
 
+	bool flushSend(IoBuffer *pBuffer);
+
+	void retrieveSend(IoBuffer *pBuffer, uint32_t size);
+
+	bool hasPendingSend() const noexcept;
+
+	void resetSendState() noexcept;
+
+	bool pauseReadIfNotWritable() noexcept;
+
+	void checkLowWatermark();
+
+	void resumeRead();
+
+	void addDeadline(DeadlineType type, uint32_t generation, uint32_t timeout);
+
+	void removeDeadline(DeadlineType type);
+
+	// Run the expiry in the strand of the connection, see DeadlineWheel::advance.
+	static void expireDeadline(ConnectionPtr pConn, uint32_t type, uint32_t generation);
+
+	void onDeadlineExpired(uint32_t type, uint32_t generation);
+
+	void abortAndClose();
+
+	void onAborted(details::IOFlags opt);
+
+	void updateLastActivity() noexcept;
+
+	void startDrain();
+
+	bool closeIfDrained();
+
+	void onDrained();
+
+	void resetDeadlines();
+
 	void onCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred);
 
+	void runIoCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred);
+
+	void leavePool() noexcept;
+
     bool disconnectAsync();
 
     void disconnect();
@@ -121,6 +296,12 @@ private:
 
 	void onAcceptConnection(uint32_t acceptSize);
 
+	void onConnected();
+
+	void updateConnectContext();
+
+	void reuseSocket();
+
 	void addReuseTimingWheel();
 
     void getAcceptPairAddress(details::SocketAddressPair &pair) const;
@@ -141,11 +322,27 @@ private:
 	};
 
 	bool isReuseSocket_ : 1;
-	bool hasUpdataAcceptContext_ : 1;
 	bool isSendShutdown_ : 1;
 	bool isRecvShutdown_ : 1;
+	bool isSendPending_ : 1;
+	bool isSocketBound_ : 1;
+	bool isAboveHighWatermark_ : 1;
+	bool isReadPaused_ : 1;
+	// Written by the deadline, drain and receive paths, kept out of the bit fields above.
+	bool isRecvPending_;
+	bool isAborting_;
+	bool isDraining_;
+	// Draining only to cancel the AcceptEx, see retire.
+	bool isRetiring_;
+	bool isRequestActive_;
+	// Set while AcceptEx is pending, see reclaimBuffers.
+	std::atomic<bool> isPooled_;
+	std::atomic<bool> isReclaiming_;
+	// Read by the pool controller, see isAcceptPending.
+	std::atomic<bool> hasUpdataAcceptContext_;
 	details::IOFlags lastOptFlags_;
 	HalfClosedState halfClosedState_;
+	details::IoEventDispatcher* pDispatcher_;
 	details::TcpServerSocket* pListenSocket_;
 	details::TcpSocket acceptSocket_;
 	details::TimingWheelPtr pTimeWaitReuseTimer_;
@@ -154,6 +351,30 @@ private:
 	std::unique_ptr<IoBuffer> pReceiveBuffer_;
 	std::unique_ptr<IoBuffer> pPostBuffer_;
 	std::unique_ptr<IoBuffer> pDisconnectBuffer_;
+	details::SendQueue sendQueue_;
+	details::PostTaskQueue postTasks_;
+	// Completions of the connection dequeued by several IO threads of the dispatcher run one at a time.
+	details::Strand strand_;
+	HANDLE sendFileHandle_;
+	uint64_t sendFileOffset_;
+	uint64_t sendFileRemaining_;
+	// Bytes of the send buffer and of the file in the write in flight, the app may append meanwhile.
+	uint32_t sendBufferBytes_;
+	uint32_t sendFileBytes_;
+	TRANSMIT_FILE_BUFFERS transmitBuffers_;
+	ConnectEventHandler connectHandler_;
+	std::function<void(ConnectionHandle&)> reuseHandler_;
+	std::function<void(ConnectionHandle&)> writableHandler_;
+	std::function<void(ConnectionHandle&)> drainedHandler_;
+	std::function<void(ConnectionHandle&)> keptHandler_;
+	uint32_t lowWatermark_;
+	uint32_t highWatermark_;
+	uint32_t timeouts_[MAX_DEADLINE_TYPE];
+	uint32_t deadlineGenerations_[MAX_DEADLINE_TYPE];
+	details::DeadlineSlot deadlineSlots_[MAX_DEADLINE_TYPE];
+	uint64_t lastActivityTime_;
+	std::atomic<uint64_t> acceptCount_;
+	std::atomic<uint64_t> bufferSize_;
 	AcceptBufferSize acceptSize_;
 	details::SocketAddressPair accpetedAddress_;
 };
@@ -166,5 +387,29 @@ __forceinline IoBuffer* Connection::getSendBuffer() const noexcept {
 	return pSendBuffer_.get();
 }
 
+__forceinline details::IoEventDispatcher & Connection::getIoEventDispatcher() const noexcept {
+	return *pDispatcher_;
+}
+
+__forceinline ConnectionHandle Connection::handle() noexcept {
+	return ConnectionHandle(this);
+}
+
+__forceinline ConnectionPtr ConnectionHandle::share() const {
+	return pConn_->shared_from_this();
+}
+
+__forceinline uint64_t Connection::getAcceptCount() const noexcept {
+	return acceptCount_.load(std::memory_order_relaxed);
+}
+
+__forceinline bool Connection::isAcceptPending() const noexcept {
+	return !hasUpdataAcceptContext_.load(std::memory_order_relaxed);
+}
+
+__forceinline uint64_t Connection::getBufferSize() const noexcept {
+	return bufferSize_.load(std::memory_order_relaxed);
+}
+
 }
 
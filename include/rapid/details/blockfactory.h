@@ -7,8 +7,15 @@
 
 #include <cstdint>
 #include <functional>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 #include <rapid/platform/platform.h>
+
+#include <mswsock.h>
+
+#include <rapid/platform/spinlock.h>
 #include <rapid/details/memallocator.h>
 
 namespace rapid {
@@ -26,29 +33,81 @@ struct Block {
 	uint32_t memSize;
 };
 
-class BlockFactory {
+class BlockFactory : public std::enable_shared_from_this<BlockFactory> {
 public:
     using TraverseCallback = std::function<void(MEMORY_BASIC_INFORMATION const &)>;
 
-    static std::shared_ptr<BlockFactory> createBlockFactory(uint8_t numNumaNode, uint32_t maxPageCount, uint32_t bufferSize);
+	// With useLargePages the whole pool is committed up front on large pages (SE_LOCK_MEMORY_NAME is
+	// required), if they can't be had it falls back to reserving small pages and committing on demand.
+    static std::shared_ptr<BlockFactory> createBlockFactory(uint8_t numNumaNode, uint32_t maxPageCount, uint32_t bufferSize, bool useLargePages = false);
 
 	BlockFactory(MemAllocatorPtr allocator, uint32_t maxPageCount, uint32_t maxPageBoundarySize);
 
+	~BlockFactory();
+
 	BlockFactory(BlockFactory const &) = delete;
 	BlockFactory& operator=(BlockFactory const &) = delete;
 
+	// Reuse a released block first, otherwise take the next unused one. Throws once all are in use, or
+	// with ERROR_NOT_ENOUGH_MEMORY if committing its first page would pass the hard memory limit.
 	Block getBlock();
 
+	// As getBlock, but commit commitSize bytes of the block (at most the buffer size) instead of its first page.
+	Block getBlock(uint32_t commitSize);
+
+	// Decommit the pages of the block and hand it out again.
+	void releaseBlock(Block const &block);
+
+	// Blocks that can still be handed out.
+	uint32_t getAvailableBlockCount() const;
+
+	// Commit every block and register them with Registered I/O as one buffer, the kernel then locks the
+	// pages once instead of per operation. Blocks stay committed from then on. Registers only once.
+	RIO_BUFFERID registerIoBuffers(RIO_EXTENSION_FUNCTION_TABLE const &rio);
+
+	bool isIoBuffersRegistered() const noexcept;
+
+	// The whole block as a slice of the registered buffer.
+	RIO_BUF getRegisteredBuffer(Block const &block) const noexcept;
+
+	// Bookkeeping of the pages buffers commit beyond the first page of their block. Call it before
+	// committing them, it throws ERROR_NOT_ENOUGH_MEMORY if they would pass the hard memory limit.
+	void addExpandedSize(uint32_t size);
+
+	void removeExpandedSize(uint32_t size) noexcept;
+
+	uint64_t getExpandedSize() const noexcept;
+
+	// Milliseconds since a buffer of the factory last grew.
+	uint64_t getExpandIdleTime() const noexcept;
+
     MemAllocatorPtr getAllocator() const;
 
 	uint32_t getSlicePageCount() const noexcept;
 
+	// Bytes committed by the factory and charged to the memory governor.
+	uint64_t getCommittedSize() const noexcept;
+
 private:
+	// Large pages and registered buffers are committed as a whole, not block by block.
+	bool isPreCommitted() const noexcept;
+
+	void chargeCommit(uint32_t size);
+
+	void releaseCommit(uint32_t size) noexcept;
+
 	MemAllocatorPtr pAllocator_;
     char *pBaseAddress_;
 	uint32_t pageBoundarySize_;
 	uint32_t totalPageCount_;
-	uint32_t count_;
+	std::atomic<uint32_t> count_;
+	std::atomic<uint64_t> expandedSize_;
+	std::atomic<uint64_t> committedSize_;
+	std::atomic<uint64_t> lastExpandTime_;
+	mutable platform::Spinlock lock_;
+	std::vector<uint32_t> freeBlocks_;
+	RIO_BUFFERID rioBufferId_;
+	LPFN_RIODEREGISTERBUFFER pfnDeregisterBuffer_;
 };
 
 }
@@ -19,7 +19,8 @@ class Buffer {
 public:
 	Buffer();
 
-    Buffer(Block const &block, MemAllocatorPtr allocator);
+	// The block goes back to the factory when the buffer is destroyed.
+    Buffer(Block const &block, std::shared_ptr<BlockFactory> factory);
 
     ~Buffer();
 
@@ -28,6 +29,11 @@ public:
 
     void expandSize(uint32_t size);
 
+	// Decommit the pages committed by expandSize, the first page of the block stays.
+	// Returns false if there were none, the pages are large pages, which can't be decommitted in part, or
+	// the factory has registered them for Registered I/O.
+	bool shrink();
+
 	uint32_t size() const noexcept;
 
     void protect() const;
@@ -40,6 +46,7 @@ private:
     uint32_t commitSize_;
     Block block_;
     MemAllocatorPtr pAllocator_;
+	std::shared_ptr<BlockFactory> pFactory_;
 };
 
 }
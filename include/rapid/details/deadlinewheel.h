@@ -0,0 +1,96 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <rapid/platform/spinlock.h>
+
+namespace rapid {
+
+class Connection;
+
+namespace details {
+
+// One deadline type of a connection, embedded in the connection and linked into a bucket of the wheel
+// of its dispatcher while armed. Arming again moves it, cancelling unlinks it, so a connection is never
+// in the wheel more than once per type. Every field is guarded by the lock of the wheel.
+struct DeadlineSlot {
+	DeadlineSlot() noexcept;
+
+	DeadlineSlot *pPrev;
+	DeadlineSlot *pNext;
+	// Taken when the slot is linked and dropped when it is unlinked, the wheel keeps the connection
+	// alive while it is armed.
+	std::shared_ptr<Connection> pOwner;
+	uint64_t expireTick;
+	uint32_t type;
+	uint32_t generation;
+	bool linked;
+};
+
+// Connection deadlines of the IO worker threads of one dispatcher. The threads advance the wheel
+// between completion batches, whichever gets the lock expires the due deadlines, so no timer thread
+// is needed. Arming and cancelling hold the lock for a few pointer updates and may be called from
+// any thread. An expired deadline runs in the strand of its connection.
+class DeadlineWheel {
+public:
+	static uint32_t constexpr TICK_DURATION = 100;
+
+	DeadlineWheel();
+
+	~DeadlineWheel();
+
+	DeadlineWheel(DeadlineWheel const &) = delete;
+	DeadlineWheel& operator=(DeadlineWheel const &) = delete;
+
+	// Arm the slot of the connection, moving it if it is already armed.
+	void add(DeadlineSlot &slot, Connection *pConn, uint32_t type, uint32_t generation, uint32_t timeout);
+
+	// Disarm the slot. The reference to the connection is released after the completion batch of the
+	// calling IO thread, not from inside the connection.
+	void remove(DeadlineSlot &slot);
+
+	// Expire the due deadlines, returns how long the IO loop may wait for completions before the next call.
+	uint32_t advance(uint32_t maxWaitTime);
+
+private:
+	static uint32_t constexpr MAX_BUCKETS = 512;
+
+	struct Expired {
+		std::shared_ptr<Connection> pConn;
+		uint32_t type;
+		uint32_t generation;
+	};
+
+	static uint64_t nowTick() noexcept;
+
+	void link(DeadlineSlot &slot) noexcept;
+
+	void unlink(DeadlineSlot &slot) noexcept;
+
+	platform::Spinlock lock_;
+	std::vector<DeadlineSlot*> buckets_;
+	uint64_t currentTick_;
+	// Read without the lock to skip an empty wheel.
+	std::atomic<size_t> numDeadlines_;
+};
+
+__forceinline DeadlineSlot::DeadlineSlot() noexcept
+	: pPrev(nullptr)
+	, pNext(nullptr)
+	, expireTick(0)
+	, type(0)
+	, generation(0)
+	, linked(false) {
+}
+
+}
+
+}
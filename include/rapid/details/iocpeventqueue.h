@@ -0,0 +1,36 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+
+#include <rapid/details/ioeventqueue.h>
+
+namespace rapid {
+
+namespace details {
+
+class IocpEventQueue : public IoEventQueue {
+public:
+    explicit IocpEventQueue(uint32_t concurrentThreadCount);
+
+    virtual ~IocpEventQueue() noexcept;
+
+    virtual bool associateDevice(HANDLE device, ULONG_PTR compKey) const noexcept override;
+
+    virtual bool enqueue(ULONG_PTR compKey, uint32_t numBytes, OVERLAPPED *overlapped) const noexcept override;
+
+    virtual bool dequeue(OVERLAPPED_ENTRY * __restrict entries, DWORD N, ULONG * __restrict removeCount, uint32_t timeout) const noexcept override;
+
+    virtual HANDLE getCompletionPort() const noexcept override;
+
+private:
+    HANDLE handle;
+};
+
+}
+
+}
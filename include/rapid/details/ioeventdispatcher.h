@@ -5,22 +5,54 @@
 
 #pragma once
 
+#include <atomic>
 #include <memory>
+#include <functional>
+#include <vector>
 
 #include <rapid/utils/singleton.h>
 #include <rapid/platform/platform.h>
 
 namespace rapid {
 
+class IoEvent;
+
 namespace details {
 
 class IoEventQueue;
 class IoEventDispatcher;
+class DeadlineWheel;
+
+struct IoWaitStats {
+	// Completion batches dequeued while busy polling.
+	uint64_t spinHits;
+	// Busy polls that used up their budget and went on to a blocking wait.
+	uint64_t spinMisses;
+	// Completion batches dequeued by a blocking wait.
+	uint64_t blockingWakes;
+};
+
+// Wait counters of one IO worker thread. The worker is their only writer, it updates them without
+// a locked instruction and any thread may read them.
+struct IoWaitCounters {
+	IoWaitCounters() noexcept;
+
+	IoWaitStats snapshot() const noexcept;
+
+	static void increment(std::atomic<uint64_t> &counter) noexcept;
+
+	std::atomic<uint64_t> spinHits;
+	std::atomic<uint64_t> spinMisses;
+	std::atomic<uint64_t> blockingWakes;
+	char pad[CACHE_LINE_PAD_SIZE - sizeof(std::atomic<uint64_t>) * 3];
+};
 
 class IoEventDispatcher : public utils::Singleton<IoEventDispatcher> {
 public:
     explicit IoEventDispatcher(uint32_t concurrentThreadCount);
 
+	explicit IoEventDispatcher(std::unique_ptr<IoEventQueue> pIoEventQueue);
+
 	IoEventDispatcher();
 
 	IoEventDispatcher(IoEventDispatcher &&other);
@@ -34,19 +66,51 @@ public:
 
     void addDevice(HANDLE device, ULONG_PTR compKey) const;
 
-    void waitForIoLoop(uint32_t timeout) const;
+	// With a busyPollTime (microseconds) the worker first polls the queue without blocking for that long,
+	// backing off with pause instructions, before it blocks for at most timeout milliseconds. It trades
+	// a busy core for the wakeup latency of an idle thread. pCounters may be nullptr.
+    void waitForIoLoop(uint32_t timeout, uint32_t busyPollTime = 0, IoWaitCounters *pCounters = nullptr) const;
 
     void postQuit() const;
 
 	void post(ULONG_PTR compKey, OVERLAPPED *overlapped) const;
 
+	void post(IoEvent *pEvent) const;
+
+	// Requeue a completion packet on this dispatcher as it was dequeued.
+	void forward(OVERLAPPED_ENTRY const &entry) const;
+
+	// Run task on one of the IO worker threads.
+	void postTask(std::function<void()> &&task) const;
+
+	// Keep pObject alive until the calling IO thread has finished its current completion batch, for a
+	// connection whose handler may drop its last reference while it is still running. Outside an IO
+	// loop pObject is released at once.
+	static void releaseAfterBatch(std::shared_ptr<void> pObject);
+
+	// Deadlines of the connections of this dispatcher, advanced by its IO worker threads.
+	DeadlineWheel & getDeadlineWheel() const noexcept;
+
+	// nullptr if the completion backend isn't an I/O completion port.
+	HANDLE getCompletionPort() const noexcept;
+
+	static auto constexpr KEY_IO_EVENT = MAXULONG_PTR - 1;
+
 private:
 	static auto constexpr KEY_IO_SERVICE_STOP = MAXULONG_PTR;
 	static auto constexpr MAX_OVERLAPPED_ENTRIES = 128;
+	static uint32_t constexpr MAX_BUSY_POLL_PAUSES = 64;
+
+	bool busyPoll(OVERLAPPED_ENTRY *entries, ULONG *removeCount, uint32_t busyPollTime) const;
     
     std::unique_ptr<IoEventQueue> pIoEventQueue_;
+	std::unique_ptr<DeadlineWheel> pDeadlineWheel_;
 };
 
+__forceinline void IoWaitCounters::increment(std::atomic<uint64_t> &counter) noexcept {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
 }
 
 }
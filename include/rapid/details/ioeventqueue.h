@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <memory>
 #include <cstdint>
 
 #include <rapid/platform/platform.h>
@@ -13,29 +14,36 @@ namespace rapid {
 
 namespace details {
 
+class IoEventQueue;
+using IoEventQueuePtr = std::unique_ptr<IoEventQueue>;
+
+// Completion backend of IoEventDispatcher. A backend must hand completions back as OVERLAPPED_ENTRY
+// batches (key, OVERLAPPED, bytes) so the dispatch loop and Connection::onIoCompletion stay unchanged.
 class IoEventQueue {
 public:
-    explicit IoEventQueue(uint32_t concurrentThreadCount);
-
     IoEventQueue(IoEventQueue const &) = delete;
     IoEventQueue& operator=(IoEventQueue const &) = delete;
 
-    ~IoEventQueue() noexcept;
+    virtual ~IoEventQueue() = default;
+
+    static IoEventQueuePtr createIoEventQueue(uint32_t concurrentThreadCount);
 
-    bool associateDevice(HANDLE device, ULONG_PTR compKey) const noexcept;
+    virtual bool associateDevice(HANDLE device, ULONG_PTR compKey) const noexcept = 0;
 
-    bool enqueue(ULONG_PTR compKey, uint32_t numBytes, OVERLAPPED *overlapped) const noexcept;
+    virtual bool enqueue(ULONG_PTR compKey, uint32_t numBytes, OVERLAPPED *overlapped) const noexcept = 0;
 
-    bool dequeue(OVERLAPPED_ENTRY * __restrict entries, DWORD N, ULONG * __restrict removeCount, uint32_t timeout) const noexcept;
+    virtual bool dequeue(OVERLAPPED_ENTRY * __restrict entries, DWORD N, ULONG * __restrict removeCount, uint32_t timeout) const noexcept = 0;
 
-private:
-    HANDLE handle;
+	// The I/O completion port behind the queue, for APIs that report to a port directly (Registered I/O).
+	// nullptr if the backend has none.
+	virtual HANDLE getCompletionPort() const noexcept {
+		return nullptr;
+	}
+
+protected:
+    IoEventQueue() = default;
 };
 
-__forceinline bool IoEventQueue::dequeue(OVERLAPPED_ENTRY * __restrict entries, DWORD N, ULONG * __restrict removeCount, uint32_t timeout) const noexcept {
-    return ::GetQueuedCompletionStatusEx(handle, entries, N, removeCount, timeout, FALSE) != FALSE;
 }
 
 }
-
-}
\ No newline at end of file
@@ -26,6 +26,8 @@ struct IOFlags {
 		IO_DISCONNECT_PENDDING,
 		IO_POST_PENDDING,
 		IO_POST_COMPLETED,
+		IO_CONNECT_COMPLETED,
+		IO_CONNECT_PENDDING,
 		_MAX_IO_OPT_FLAG_
 	};
 
@@ -63,6 +65,8 @@ struct IOFlags {
 			OUTPUT_CASE_STR(IO_DISCONNECT_PENDDING);
 			OUTPUT_CASE_STR(IO_POST_PENDDING);
 			OUTPUT_CASE_STR(IO_POST_COMPLETED);
+			OUTPUT_CASE_STR(IO_CONNECT_COMPLETED);
+			OUTPUT_CASE_STR(IO_CONNECT_PENDDING);
 			break;
 		}
 		return ostr;
@@ -0,0 +1,87 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <rapid/platform/platform.h>
+
+namespace rapid {
+
+namespace details {
+
+class IoEventDispatcher;
+class IoThreadPool;
+class BlockFactory;
+struct IoWaitStats;
+
+class IoShard;
+using IoShardPtr = std::shared_ptr<IoShard>;
+
+// A shard owns a completion queue, the worker threads draining it and the buffer memory of its
+// connections. A connection is bound to one shard for its whole life, so its state is only ever
+// touched by the threads of that shard. Every shard owns its dispatcher, the process-wide
+// IoEventDispatcher instance is left to UdpServer and IoThreadPool users outside a TcpServer.
+class IoShard {
+public:
+	static IoShardPtr createIoShard(uint32_t index, uint32_t threadCount, std::shared_ptr<BlockFactory> pBlockFactory);
+
+	IoShard(uint32_t index, uint32_t threadCount, std::shared_ptr<BlockFactory> pBlockFactory);
+
+	IoShard(IoShard const &) = delete;
+	IoShard& operator=(IoShard const &) = delete;
+
+	~IoShard();
+
+	// See IoThreadPool::setBusyPollTime, must be called before start.
+	void setBusyPollTime(uint32_t busyPollTime);
+
+	// One affinity per worker thread, see IoThreadPool::setThreadAffinity. Must be called before start.
+	void setThreadAffinity(std::vector<GROUP_AFFINITY> const &affinities);
+
+	void start();
+
+	void stop();
+
+	uint32_t index() const noexcept;
+
+	IoEventDispatcher & getIoEventDispatcher() const noexcept;
+
+	std::shared_ptr<BlockFactory> const & getBlockFactory() const noexcept;
+
+	std::vector<std::thread> const & threads() const;
+
+	// Wait counters of the worker threads, in the order of threads().
+	std::vector<IoWaitStats> getWaitStats() const;
+
+private:
+	uint32_t index_;
+	uint32_t numThreads_;
+	uint32_t busyPollTime_;
+	std::unique_ptr<IoEventDispatcher> pDispatcher_;
+	std::shared_ptr<BlockFactory> pBlockFactory_;
+	std::unique_ptr<IoThreadPool> pThreadPool_;
+	std::vector<GROUP_AFFINITY> affinities_;
+};
+
+__forceinline uint32_t IoShard::index() const noexcept {
+	return index_;
+}
+
+__forceinline IoEventDispatcher & IoShard::getIoEventDispatcher() const noexcept {
+	return *pDispatcher_;
+}
+
+__forceinline std::shared_ptr<BlockFactory> const & IoShard::getBlockFactory() const noexcept {
+	return pBlockFactory_;
+}
+
+}
+
+}
@@ -8,35 +8,58 @@
 #include <thread>
 #include <memory>
 #include <vector>
+#include <string>
 
 #include <atomic>
 
+#include <rapid/platform/platform.h>
+
 namespace rapid {
 
 namespace details {
 
+class IoEventDispatcher;
+struct IoWaitCounters;
+struct IoWaitStats;
+
 class IoThreadPool {
 public:
 	explicit IoThreadPool(uint32_t threadCount);
 
+	IoThreadPool(uint32_t threadCount, IoEventDispatcher &dispatcher, std::string const &name);
+
     IoThreadPool(IoThreadPool const &) = delete;
     IoThreadPool& operator=(IoThreadPool const &) = delete;
 
     ~IoThreadPool();
 
+	// Busy poll the completion queue for busyPollTime microseconds before blocking, 0 (the default)
+	// always blocks. Must be called before runAll.
+	void setBusyPollTime(uint32_t busyPollTime);
+
+	// Pin worker thread i to affinities[i], must be called before runAll.
+	void setThreadAffinity(std::vector<GROUP_AFFINITY> const &affinities);
+
     void runAll();
 
     void joinAll();
 
     std::vector<std::thread> const & threads() const;
 
+	IoWaitStats getWaitStats(uint32_t threadIndex) const;
+
 private:
 	static auto constexpr MAX_START_THREAD_TIME_EXPIRED = 40000;
 
 	void ensureStarted();
     uint32_t numThreads_;
+	uint32_t busyPollTime_;
+	IoEventDispatcher *pDispatcher_;
+	std::string name_;
 	std::atomic<int> padCacheLineSizeCount_;
 	std::atomic<int> startedThreadCount_;
+	std::unique_ptr<IoWaitCounters[]> pWaitCounters_;
+	std::vector<GROUP_AFFINITY> affinities_;
     std::vector<std::thread> pool_;
 };
 
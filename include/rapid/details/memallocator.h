@@ -38,6 +38,10 @@ public:
         return memoryAllocateSize_;
     }
 
+	bool isLargePages() const noexcept {
+		return useLargePages_;
+	}
+
 protected:
     MemAllocator(uint32_t size, bool useLargePages)
         : pBaseAddress_(nullptr)
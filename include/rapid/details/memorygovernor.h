@@ -0,0 +1,94 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+#include <rapid/utils/singleton.h>
+
+namespace rapid {
+
+namespace details {
+
+enum MemoryCategory {
+	MEMORY_IO_BUFFER = 0,
+	MEMORY_FILE_CACHE,
+	MEMORY_ARENA,
+	MAX_MEMORY_CATEGORY,
+};
+
+enum MemoryPressure {
+	// Below the soft limit.
+	MEMORY_PRESSURE_NONE = 0,
+	// Above the soft limit: stop growing, give back what can be given back.
+	MEMORY_PRESSURE_SOFT,
+	// In the last quarter between the soft and the hard limit: new connections are refused and the
+	// largest consumers shed before tryCharge starts refusing at the hard limit itself.
+	MEMORY_PRESSURE_HARD,
+};
+
+// Process wide budget of the memory committed by the buffer pools, the file cache and the request arenas.
+// The consumers charge what they commit and release it when they decommit; the accept poller reads the
+// pressure each control round to apply the policies. A limit of 0 (the default) disables it.
+class MemoryGovernor : public utils::Singleton<MemoryGovernor> {
+public:
+	MemoryGovernor();
+
+	void setLimits(uint64_t softLimit, uint64_t hardLimit);
+
+	// Account memory that is committed anyway.
+	void charge(MemoryCategory category, uint64_t size) noexcept;
+
+	// Account memory about to be committed, returns false without charging if it would pass the hard limit.
+	bool tryCharge(MemoryCategory category, uint64_t size) noexcept;
+
+	void release(MemoryCategory category, uint64_t size) noexcept;
+
+	MemoryPressure getPressure() const noexcept;
+
+	uint64_t getCommittedSize() const noexcept;
+
+	uint64_t getCommittedSize(MemoryCategory category) const noexcept;
+
+	uint64_t getSoftLimit() const noexcept;
+
+	uint64_t getHardLimit() const noexcept;
+
+	// Charges refused by tryCharge.
+	uint64_t getRefusedCount() const noexcept;
+
+private:
+	std::atomic<uint64_t> softLimit_;
+	std::atomic<uint64_t> hardLimit_;
+	std::atomic<uint64_t> committedSize_;
+	std::atomic<uint64_t> refusedCount_;
+	std::atomic<uint64_t> categorySizes_[MAX_MEMORY_CATEGORY];
+};
+
+__forceinline uint64_t MemoryGovernor::getCommittedSize() const noexcept {
+	return committedSize_.load(std::memory_order_relaxed);
+}
+
+__forceinline uint64_t MemoryGovernor::getCommittedSize(MemoryCategory category) const noexcept {
+	return categorySizes_[category].load(std::memory_order_relaxed);
+}
+
+__forceinline uint64_t MemoryGovernor::getSoftLimit() const noexcept {
+	return softLimit_.load(std::memory_order_relaxed);
+}
+
+__forceinline uint64_t MemoryGovernor::getHardLimit() const noexcept {
+	return hardLimit_.load(std::memory_order_relaxed);
+}
+
+__forceinline uint64_t MemoryGovernor::getRefusedCount() const noexcept {
+	return refusedCount_.load(std::memory_order_relaxed);
+}
+
+}
+
+}
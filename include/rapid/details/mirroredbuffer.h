@@ -0,0 +1,58 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <rapid/platform/platform.h>
+
+namespace rapid {
+
+namespace details {
+
+// Ring memory whose pages are mapped twice back to back: the bytes at begin() + i and
+// begin() + size() + i are the same, so size() bytes starting at any offset below size() are contiguous.
+// Built with VirtualAlloc2 placeholders and MapViewOfFile3, available since Windows 10 1803.
+class MirroredBuffer {
+public:
+	// False if the system lacks the placeholder API.
+	static bool isSupported();
+
+	// The size is rounded up to the allocation granularity. Charged to the memory governor, throws
+	// ERROR_NOT_ENOUGH_MEMORY if it is refused.
+	explicit MirroredBuffer(uint32_t size);
+
+	~MirroredBuffer();
+
+	MirroredBuffer(MirroredBuffer const &) = delete;
+	MirroredBuffer& operator=(MirroredBuffer const &) = delete;
+
+	char* begin() const noexcept;
+
+	uint32_t size() const noexcept;
+
+private:
+	void unmap() noexcept;
+
+	char *pView_;
+	char *pMirrorView_;
+	uint32_t size_;
+};
+
+using MirroredBufferPtr = std::unique_ptr<MirroredBuffer>;
+
+__forceinline char* MirroredBuffer::begin() const noexcept {
+	return pView_;
+}
+
+__forceinline uint32_t MirroredBuffer::size() const noexcept {
+	return size_;
+}
+
+}
+
+}
@@ -0,0 +1,57 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+#include <rapid/eventhandler.h>
+
+namespace rapid {
+
+namespace details {
+
+// Lock-free multi-producer single-consumer queue of the tasks posted to a connection. Producers push
+// with one CAS, the owner IO thread takes every queued task at once. Only the push onto an empty queue
+// reports it, so one completion packet covers every task queued until the owner drains the queue.
+class PostTaskQueue {
+public:
+	using Task = std::function<void(ConnectionHandle)>;
+
+	PostTaskQueue() noexcept;
+
+	~PostTaskQueue();
+
+	PostTaskQueue(PostTaskQueue const &) = delete;
+	PostTaskQueue& operator=(PostTaskQueue const &) = delete;
+
+	// Returns true if the queue was empty, the caller then has to wake up the consumer.
+	bool push(Task task);
+
+	// Run the queued tasks in FIFO order on the consumer thread, returns how many have run.
+	// A task that throws is logged and doesn't stop the others.
+	size_t drain(ConnectionHandle &pConn);
+
+	bool isEmpty() const noexcept;
+
+private:
+	struct Node {
+		Node *pNext;
+		Task task;
+	};
+
+	static void release(Node *pNode) noexcept;
+
+	std::atomic<Node*> pHead_;
+};
+
+__forceinline bool PostTaskQueue::isEmpty() const noexcept {
+	return pHead_.load(std::memory_order_acquire) == nullptr;
+}
+
+}
+
+}
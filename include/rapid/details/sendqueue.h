@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <deque>
+
+#include <rapid/platform/platform.h>
+
+namespace rapid {
+
+namespace details {
+
+struct SendSegment {
+	SendSegment(char const *data, uint32_t length, std::shared_ptr<void const> owner)
+		: pData(data)
+		, length(length)
+		, pOwner(std::move(owner)) {
+	}
+
+	char const *pData;
+	uint32_t length;
+	// Keeps the memory alive until the segment has been fully sent.
+	std::shared_ptr<void const> pOwner;
+};
+
+// FIFO of memory segments sent with one gather write. Partial sends advance across segment
+// boundaries, a segment is released only when its last byte has been sent.
+class SendQueue {
+public:
+	SendQueue();
+
+	SendQueue(SendQueue const &) = delete;
+	SendQueue& operator=(SendQueue const &) = delete;
+
+	void push(char const *data, uint32_t length, std::shared_ptr<void const> owner);
+
+	uint32_t gather(WSABUF *iovec, uint32_t maxIovec) const noexcept;
+
+	void retrieve(uint32_t size);
+
+	void clear() noexcept;
+
+	bool isEmpty() const noexcept;
+
+	uint64_t size() const noexcept;
+
+private:
+	std::deque<SendSegment> segments_;
+	uint64_t queuedBytes_;
+};
+
+__forceinline bool SendQueue::isEmpty() const noexcept {
+	return segments_.empty();
+}
+
+__forceinline uint64_t SendQueue::size() const noexcept {
+	return queuedBytes_;
+}
+
+}
+
+}
@@ -70,6 +70,8 @@ protected:
 
     explicit Socket(SOCKET sd);
     Socket(int family, int type, int protocol);
+	// Created with WSASocket and the given WSA_FLAG_ flags.
+	Socket(int family, int type, int protocol, DWORD flags);
     SOCKET sockDesc_;
 };
 
@@ -95,6 +97,7 @@ public:
 
 protected:
     CommunicatingSocket(int family, int type, int protocol);
+	CommunicatingSocket(int family, int type, int protocol, DWORD flags);
     explicit CommunicatingSocket(SOCKET newConnSD);
 };
 
@@ -111,6 +114,16 @@ private:
     explicit TcpSocket(SOCKET newConnSD);
 };
 
+class UdpSocket : public CommunicatingSocket {
+public:
+    UdpSocket(std::string const &localAddress, unsigned short localPort);
+
+	// With useRegisteredIo the socket is created for Registered I/O (WSA_FLAG_REGISTERED_IO).
+	UdpSocket(std::string const &localAddress, unsigned short localPort, bool useRegisteredIo);
+
+    virtual ~UdpSocket() = default;
+};
+
 class TcpServerSocket : public Socket {
 public:
     explicit TcpServerSocket(unsigned short localPort, int queueLen = SOMAXCONN, int family = AF_INET);
@@ -9,11 +9,15 @@
 #include <memory>
 #include <thread>
 #include <vector>
+#include <atomic>
 
 #include <rapid/platform/platform.h>
+#include <rapid/platform/spinlock.h>
 #include <rapid/details/socket.h>
 
 #include <rapid/details/timingwheel.h>
+#include <rapid/details/ioshard.h>
+#include <rapid/details/memorygovernor.h>
 #include <rapid/eventhandler.h>
 #include <rapid/connection.h>
 
@@ -25,9 +29,9 @@ namespace details {
 
 class IoEventDispatcher;
 
-class SocketAcceptPooller {
+class SocketAcceptPooller : public std::enable_shared_from_this<SocketAcceptPooller> {
 public:
-    SocketAcceptPooller(std::shared_ptr<TcpServerSocket> &listenSocket, std::shared_ptr<BlockFactory> &factory);
+    SocketAcceptPooller(std::shared_ptr<TcpServerSocket> &listenSocket, std::vector<IoShardPtr> const &shards);
 
     SocketAcceptPooller(SocketAcceptPooller const &) = delete;
     SocketAcceptPooller& operator=(SocketAcceptPooller const &) = delete;
@@ -42,32 +46,92 @@ public:
 
     void stopPoll();
 
+	// Call it after startPoll.
+	void setPollerThreadAffinity(GROUP_AFFINITY const &affinity);
+
+	// Stop adding sockets to the pool and drain every pooled connection.
+	void startDrain();
+
+	size_t getPoolSize() const;
+
+	size_t getDrainedCount() const noexcept;
+
     void setContextEventHandler(ContextEventHandler &&callback);
 
 private:
 	static auto constexpr DEFAULT_POOL_SIZE = 100;
-	static auto constexpr POLL_NETWORK_EVENT_TIMEOUT = 15000;
-
-	void createSocket(std::vector<ConnectionPtr> &newConnList);
+	static auto constexpr POLL_NETWORK_EVENT_TIMEOUT = 1000;
+	static auto constexpr ACCEPT_BATCH_SIZE = 16;
+	// Pool controller: keep BURST_WINDOW seconds of the smoothed accept rate posted as AcceptEx,
+	// retire the surplus once it has stayed above twice that for RETIRE_DELAY control rounds.
+	static auto constexpr ACCEPT_RATE_WEIGHT = 0.25;
+	static auto constexpr BURST_WINDOW = 2;
+	static auto constexpr RETIRE_DELAY = 30;
+	// Pooled sockets give back the buffer pages grown beyond the first one once no buffer of the shard
+	// has grown for RECLAIM_DELAY milliseconds, i.e. the burst that needed them is over, or at once
+	// under memory pressure.
+	static auto constexpr RECLAIM_DELAY = 10000;
+	// Under hard memory pressure at most SHED_BATCH connections, the ones with the largest buffers,
+	// are closed per control round.
+	static auto constexpr SHED_BATCH = 16;
+
+	struct ShardPool {
+		explicit ShardPool(IoShardPtr shard);
+
+		IoShardPtr pShard;
+		// Guarded by lock_, reset by stopPoll.
+		TimingWheelPtr pReuseTimingWheel;
+		std::vector<ConnectionPtr> connPool;
+		size_t pendingSocketCount;
+	};
+
+	void createSocket(ShardPool &pool, TimingWheelPtr const &reuseTimingWheel, std::vector<ConnectionPtr> &newConnList);
+
+	void createSocketBatch(size_t shardIndex, size_t count);
+
+	void postSocketBatch(size_t shardIndex, size_t count);
 	
 	bool hasAcceptConnection(WSANETWORKEVENTS *events) const;
     
-	void addSocketToPool();
+	void addSocketToPool(size_t count);
+
+	void adjustPoolSize(bool hasBacklog);
+
+	void retireSockets(size_t count);
+
+	void removeFromPool(size_t shardIndex, ConnectionHandle pConn);
+
+	void reclaimBuffers(bool isUnderPressure);
+
+	void applyMemoryPolicy(MemoryPressure pressure, size_t outstanding);
+
+	void shedConnections();
     
 	void pollNetworkEvent();
 
     void pollLoop();
 
+	void stopPollerThread();
+
     ContextEventHandler contextCallback_;
-    std::vector<ConnectionPtr> connPool_;
+    mutable platform::Spinlock lock_;
+    std::vector<ShardPool> shardPools_;
     std::shared_ptr<details::TcpServerSocket> pListenSocket_;
-	TimingWheelPtr pReuseTimingWheel_;
-    std::shared_ptr<BlockFactory> pBlockFactory_;
     std::thread pollerThread_;
     HANDLE postMoreAcceptEvent_;
     HANDLE shutdownEvent_;
     size_t maxPoolSize_;
     size_t scaleSize_;
+	std::atomic<bool> isDraining_;
+	std::atomic<size_t> drainedCount_;
+	double acceptRate_;
+	uint64_t lastAcceptCount_;
+	uint64_t retiredAcceptCount_;
+	// Retired sockets that accepted a client before their AcceptEx was cancelled, and stay in the pool.
+	std::atomic<uint64_t> retireKeptCount_;
+	uint64_t lastControlTime_;
+	uint32_t surplusRounds_;
+	MemoryPressure lastPressure_;
 };
 
 }
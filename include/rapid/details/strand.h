@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+namespace rapid {
+
+namespace details {
+
+// Runs the work of one connection one piece at a time, whichever IO threads of its dispatcher it
+// arrives on. A thread that finds the strand idle runs its work at once; work arriving meanwhile is
+// queued and run by that thread before it leaves, in arrival order. Without contention it costs two
+// CAS and allocates nothing.
+class Strand {
+public:
+	Strand() noexcept;
+
+	~Strand();
+
+	Strand(Strand const &) = delete;
+	Strand& operator=(Strand const &) = delete;
+
+	template <typename Work>
+	void dispatch(Work &&work);
+
+private:
+	using Task = std::function<void()>;
+
+	struct Node {
+		Node *pNext;
+		Task task;
+	};
+
+	static Node * busy() noexcept;
+
+	bool tryEnter() noexcept;
+
+	// Returns false if the strand went idle meanwhile, the caller has then entered it and runs the work.
+	bool enqueue(Task &&task);
+
+	void leave();
+
+	// State: nullptr when idle, busy() while running with nothing queued, else the queued tasks (LIFO).
+	std::atomic<Node*> pState_;
+};
+
+template <typename Work>
+__forceinline void Strand::dispatch(Work &&work) {
+	if (!tryEnter() && enqueue(Task(work))) {
+		return;
+	}
+	try {
+		work();
+	} catch (...) {
+		leave();
+		throw;
+	}
+	leave();
+}
+
+}
+
+}
@@ -64,6 +64,9 @@ public:
 
     bool hasIFSHandleInstalled() const noexcept;
 
+	// Registered I/O functions, nullptr if the system has no RIO support (before Windows 8).
+	RIO_EXTENSION_FUNCTION_TABLE const * getRegisteredIoTable() const noexcept;
+
 	static void cancelPendingIoRequest(Socket const &socket, OVERLAPPED *overlapped);
 
     void cancelAllPendingIoRequest(Socket const &socket) const;
@@ -77,8 +80,10 @@ private:
     LPFN_GETACCEPTEXSOCKADDRS pfnGetAcceptExAddrs_;
     LPFN_CONNECTEX pfnConnectEx_;
     LPFN_TRANSMITFILE pfnTransmitFile_;
+	RIO_EXTENSION_FUNCTION_TABLE rioTable_;
 	
     bool isIfsHandleFlag_;
+	bool hasRegisteredIo_;
 };
 
 __forceinline bool WsaExtAPI::connectEx(TcpSocket const &socket,
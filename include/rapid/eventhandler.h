@@ -5,6 +5,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <functional>
 
@@ -14,6 +15,46 @@ class Connection;
 using ConnectionPtr = std::shared_ptr<Connection>;
 using WeakTcpClientChannelPtr = std::weak_ptr<Connection>;
 
+// The connection as passed to the event handlers. It refers to the connection without owning it, so
+// passing and copying it costs no atomic reference count. It stays valid as long as the TcpServer or
+// TcpClient that created the connection; to keep the connection beyond that, e.g. in a container or a
+// task of another thread, take an owning reference with share().
+class ConnectionHandle {
+public:
+	ConnectionHandle() noexcept
+		: pConn_(nullptr) {
+	}
+
+	explicit ConnectionHandle(Connection *pConn) noexcept
+		: pConn_(pConn) {
+	}
+
+	Connection* operator->() const noexcept {
+		return pConn_;
+	}
+
+	Connection& operator*() const noexcept {
+		return *pConn_;
+	}
+
+	Connection* get() const noexcept {
+		return pConn_;
+	}
+
+	explicit operator bool() const noexcept {
+		return pConn_ != nullptr;
+	}
+
+	ConnectionPtr share() const;
+
+private:
+	Connection *pConn_;
+};
+
+// Receives the owning reference of a connection just created for the pool.
 using ContextEventHandler = std::function<void(ConnectionPtr&)>;
 
+// The error is ERROR_SUCCESS when the connection has been established.
+using ConnectEventHandler = std::function<void(ConnectionHandle&, uint32_t)>;
+
 }
\ No newline at end of file
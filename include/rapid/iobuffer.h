@@ -12,12 +12,11 @@
 #include <rapid/platform/platform.h>
 #include <rapid/details/ioflags.h>
 #include <rapid/details/buffer.h>
+#include <rapid/details/mirroredbuffer.h>
+#include <rapid/eventhandler.h>
 
 namespace rapid {
 
-class Connection;
-using ConnectionPtr = std::shared_ptr<Connection>;
-
 namespace details {
 class Socket;
 }
@@ -69,6 +68,25 @@ public:
 
     void reset() noexcept;
 
+	// Give the pages grown beyond the first one back to the system, the buffer must be empty.
+	// Does nothing to a ring buffer, which may be the target of pending IO, see releaseRingBuffer.
+	bool shrink();
+
+	// Switch to a ring of at least size bytes mapped twice back to back, the readable bytes are kept.
+	// The read and write windows stay contiguous across the wrap, so a long-lived stream is never
+	// compacted. Returns false if the system can't map the ring, the buffer stays linear then.
+	bool setRingBuffer(uint32_t size);
+
+	bool isRingBuffer() const noexcept;
+
+	// Unmap the ring and go back to the linear block, the buffer is reset. Call it on the IO thread
+	// with no IO pending on the buffer, e.g. before the socket is reused.
+	void releaseRingBuffer() noexcept;
+
+	// Keep counter charged with the committed size of this buffer from now on, so another thread may
+	// read it without touching the buffer. Buffers sharing a counter add up.
+	void chargeSizeTo(std::atomic<uint64_t> &counter) noexcept;
+
     char * writeData();
 
     char * peek();
@@ -77,13 +95,13 @@ public:
 
     char const * peek() const;
 
-	bool readSome(std::shared_ptr<Connection> pConn);
+	bool readSome(ConnectionHandle pConn);
 
-	bool readSome(std::shared_ptr<Connection> pConn, uint32_t requireSize);
+	bool readSome(ConnectionHandle pConn, uint32_t requireSize);
 
     void resetOverlappedValue() noexcept;
 
-    bool send(std::shared_ptr<Connection> pConn);
+    bool send(ConnectionHandle pConn);
 
     void advanceWriteIndex(uint32_t size);
 
@@ -105,10 +123,16 @@ public:
 	void lockOverlappedRange(details::Socket &socket);
 #endif
 
+	// Assigns a std::function, which may allocate and throw.
 	template <typename EventHandler>
-	void setCompleteHandler(EventHandler &&handler) noexcept;
+	void setCompleteHandler(EventHandler &&handler);
+
+	// Complete with (pObject->*Handler)(pConn). The member is bound at compile time and inlined into
+	// a plain function, nothing is allocated, so it is cheap to rebind per request.
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	void setCompleteHandler(T *pObject) noexcept;
 
-	void onComplete(ConnectionPtr &pConn) const;
+	void onComplete(ConnectionHandle &pConn) const;
 
 	details::IOFlags ioFlag;
 
@@ -117,8 +141,23 @@ private:
     uint32_t writeIndex_;
     uint32_t readIndex_;
     uint32_t prependable_;
+	template <typename T, void (T::*Handler)(ConnectionHandle&)>
+	static void invokeHandler(void *pObject, ConnectionHandle &pConn);
+
+	uint32_t writeLimit() const noexcept;
+
+	void remapRing(uint32_t size);
+
+	// Charge the counter with the change of size() since it was oldSize.
+	void updateChargedSize(uint32_t oldSize) noexcept;
+
 	details::Buffer buffer_;
-	std::function<void(ConnectionPtr&)> handler_;
+	details::MirroredBufferPtr pRing_;
+	// Takes precedence over handler_ when set.
+	void (*pfnHandler_)(void *, ConnectionHandle&);
+	void *pHandlerObject_;
+	std::function<void(ConnectionHandle&)> handler_;
+	std::atomic<uint64_t> *pChargedSize_;
 };
 
 __forceinline bool IoBuffer::hasCompleted() const noexcept {
@@ -126,13 +165,38 @@ __forceinline bool IoBuffer::hasCompleted() const noexcept {
 }
 
 template <typename EventHandler>
-__forceinline void IoBuffer::setCompleteHandler(EventHandler &&handler) noexcept {
-	handler_ = std::move(handler);
+__forceinline void IoBuffer::setCompleteHandler(EventHandler &&handler) {
+	handler_ = std::forward<EventHandler>(handler);
+	pfnHandler_ = nullptr;
+}
+
+template <typename T, void (T::*Handler)(ConnectionHandle&)>
+__forceinline void IoBuffer::setCompleteHandler(T *pObject) noexcept {
+	pHandlerObject_ = pObject;
+	pfnHandler_ = &IoBuffer::invokeHandler<T, Handler>;
+}
+
+template <typename T, void (T::*Handler)(ConnectionHandle&)>
+void IoBuffer::invokeHandler(void *pObject, ConnectionHandle &pConn) {
+	(static_cast<T*>(pObject)->*Handler)(pConn);
 }
 
-__forceinline void IoBuffer::onComplete(ConnectionPtr &pConn) const {
+__forceinline void IoBuffer::onComplete(ConnectionHandle &pConn) const {
 	hasCompleted_ = true;
-	handler_(pConn);
+	if (pfnHandler_ != nullptr) {
+		pfnHandler_(pHandlerObject_, pConn);
+	} else {
+		handler_(pConn);
+	}
+}
+
+__forceinline bool IoBuffer::isRingBuffer() const noexcept {
+	return pRing_ != nullptr;
+}
+
+__forceinline uint32_t IoBuffer::writeLimit() const noexcept {
+	// In ring mode the write index may run up to one ring past the read index, into the mirror.
+	return pRing_ != nullptr ? readIndex_ + pRing_->size() : buffer_.size();
 }
 
 __forceinline bool IoBuffer::isEmpty() const {
@@ -5,18 +5,14 @@
 
 #pragma once
 
-#include <memory>
+#include <cstdint>
 
 #include <rapid/platform/platform.h>
 
 namespace rapid {
 
-namespace details {
-class IoEventLoop;
-}
-
-class IoBuffer;
-
+// Completion target that is not bound to a Connection (posted tasks, datagram sockets...).
+// IoEventDispatcher delivers it under the completion key IoEventDispatcher::KEY_IO_EVENT.
 class IoEvent : public OVERLAPPED {
 public:
 	virtual ~IoEvent() = default;
@@ -33,8 +29,8 @@ public:
 		hEvent = nullptr;
 	}
 
-	void onIoCompletion(std::shared_ptr<details::IoEventLoop> loop, IoBuffer *pBuffer, uint32_t bytesTransferred) {
-		return onCompletion(loop, pBuffer, bytesTransferred);
+	void onIoCompletion(uint32_t bytesTransferred) {
+		return onCompletion(bytesTransferred);
 	}
 
 protected:
@@ -42,9 +38,7 @@ protected:
 		resetOverlappedValue();
 	}
 
-	virtual void onCompletion(std::shared_ptr<details::IoEventLoop> &loop,
-		IoBuffer *pBuffer,
-		uint32_t bytesTransferred) = 0;
+	virtual void onCompletion(uint32_t bytesTransferred) = 0;
 };
 
 }
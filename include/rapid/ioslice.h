@@ -0,0 +1,107 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rapid/details/contracts.h>
+
+namespace rapid {
+
+// Immutable bytes shared by reference count. Copies and sub-slices share the same bytes, so one cached
+// file or one serialized message can be queued to any number of connections with Connection::enqueueSend
+// without a per-connection copy. The bytes are released with the last slice that refers to them.
+class IoSlice {
+public:
+	IoSlice() noexcept;
+
+	// Copy the bytes once into a new shared block.
+	IoSlice(char const *data, uint32_t length);
+
+	explicit IoSlice(std::string const &str);
+
+	// Share the bytes of an existing container, which must not be modified afterwards.
+	explicit IoSlice(std::shared_ptr<std::vector<char> const> pBytes);
+
+	explicit IoSlice(std::shared_ptr<std::string const> pBytes);
+
+	// The range [offset, offset + length) of this slice, sharing its bytes.
+	IoSlice slice(uint32_t offset, uint32_t length) const;
+
+	char const * data() const noexcept;
+
+	uint32_t size() const noexcept;
+
+	bool isEmpty() const noexcept;
+
+	std::shared_ptr<void const> const & owner() const noexcept;
+
+private:
+	IoSlice(std::shared_ptr<void const> pOwner, char const *data, uint32_t length) noexcept;
+
+	std::shared_ptr<void const> pOwner_;
+	char const *pData_;
+	uint32_t length_;
+};
+
+__forceinline IoSlice::IoSlice() noexcept
+	: pData_(nullptr)
+	, length_(0) {
+}
+
+__forceinline IoSlice::IoSlice(std::shared_ptr<void const> pOwner, char const *data, uint32_t length) noexcept
+	: pOwner_(std::move(pOwner))
+	, pData_(data)
+	, length_(length) {
+}
+
+inline IoSlice::IoSlice(char const *data, uint32_t length)
+	: IoSlice(std::make_shared<std::string const>(data, length)) {
+}
+
+inline IoSlice::IoSlice(std::string const &str)
+	: IoSlice(std::make_shared<std::string const>(str)) {
+}
+
+inline IoSlice::IoSlice(std::shared_ptr<std::vector<char> const> pBytes)
+	: pData_(pBytes->data())
+	, length_(static_cast<uint32_t>(pBytes->size())) {
+	RAPID_ENSURE(pBytes->size() <= UINT32_MAX);
+	pOwner_ = std::move(pBytes);
+}
+
+inline IoSlice::IoSlice(std::shared_ptr<std::string const> pBytes)
+	: pData_(pBytes->data())
+	, length_(static_cast<uint32_t>(pBytes->size())) {
+	RAPID_ENSURE(pBytes->size() <= UINT32_MAX);
+	pOwner_ = std::move(pBytes);
+}
+
+inline IoSlice IoSlice::slice(uint32_t offset, uint32_t length) const {
+	RAPID_ENSURE(offset <= length_ && length <= length_ - offset);
+	return IoSlice(pOwner_, pData_ + offset, length);
+}
+
+__forceinline char const * IoSlice::data() const noexcept {
+	return pData_;
+}
+
+__forceinline uint32_t IoSlice::size() const noexcept {
+	return length_;
+}
+
+__forceinline bool IoSlice::isEmpty() const noexcept {
+	return length_ == 0;
+}
+
+__forceinline std::shared_ptr<void const> const & IoSlice::owner() const noexcept {
+	return pOwner_;
+}
+
+}
@@ -83,6 +83,9 @@ void addLogAppender(std::shared_ptr<LogAppender> pAppender);
 
 void stopLogging();
 
+// Pin the thread writing the log entries to processorMask of the processor group.
+void setLoggingThreadAffinity(uint16_t group, uint64_t processorMask);
+
 class LogEntryWrapper {
 public:   
 	LogEntryWrapper(char const *file, int line, char const *function, Level level);
@@ -7,6 +7,7 @@
 
 #include <memory>
 #include <atomic>
+#include <utility>
 
 #include <rapid/platform/slist.h>
 
@@ -17,23 +18,26 @@ class GenericObjectPool {
 public:
     class DefaultObjectDeleter {
     public:
-        DefaultObjectDeleter() {
+        DefaultObjectDeleter()
+			: pOwner(nullptr) {
         }
 
-        explicit DefaultObjectDeleter(std::weak_ptr<GenericObjectPool<T, DeletePolicy>*> pool)
-            : pPool(pool) {
+        DefaultObjectDeleter(GenericObjectPool<T, DeletePolicy> *owner, std::weak_ptr<GenericObjectPool<T, DeletePolicy>*> pool)
+            : pOwner(owner)
+			, pPool(pool) {
         }
 
         void operator()(T* pT) {
-            auto pool = pPool.lock();
-            if (!pool) {
+			// expired() only reads the shared count, returning an object writes nothing shared by the pool.
+            if (pPool.expired()) {
 				// poolѦҤwĴNdelete object!
 				DeletePolicy{}(pT);
 				return;
             }
 			try {
 				// poolѦҦĩ^pool
-				(*pool.get())->returnObject(std::unique_ptr<T, DefaultObjectDeleter> { pT });
+				// The deleter moves along with the object, a copy would bump the weak count.
+				pOwner->returnObject(std::unique_ptr<T, DefaultObjectDeleter> { pT, std::move(*this) });
 				return;
 			}
 			catch (...) {
@@ -41,13 +45,28 @@ public:
 			}
         }
     private:
+		GenericObjectPool<T, DeletePolicy> *pOwner;
         std::weak_ptr<GenericObjectPool<T, DeletePolicy>*> pPool;
     };
 
     using PoolablesObjectPtr = std::unique_ptr<T, DefaultObjectDeleter>;
 
+	struct PoolStats {
+		// Served from the calling thread's magazines, folded in at each magazine exchange.
+		uint64_t hits;
+		// Served by exchanging a magazine or taking a loose object from the depot.
+		uint64_t depotHits;
+		// Had to allocate a new object.
+		uint64_t misses;
+	};
+
+	// Objects per magazine; a thread touches the shared depot at most once per MAGAZINE_SIZE operations.
+	static uint32_t constexpr MAGAZINE_SIZE = 32;
+
     GenericObjectPool();
 
+	~GenericObjectPool();
+
     GenericObjectPool(GenericObjectPool const &) = delete;
     GenericObjectPool& operator=(GenericObjectPool const &) = delete;
 
@@ -59,26 +78,104 @@ public:
 
 	void destory();
 
-	uint16_t count() const {
-		return pFreelist_.count();
+	uint32_t count() const {
+		return pFreelist_.count() + depotCount_.load(std::memory_order_relaxed);
 	}
 
+	PoolStats stats() const noexcept;
+
 private:
+	struct Magazine {
+		Magazine()
+			: size(0) {
+		}
+
+		bool isEmpty() const noexcept {
+			return size == 0;
+		}
+
+		bool isFull() const noexcept {
+			return size == MAGAZINE_SIZE;
+		}
+
+		uint32_t size;
+		PoolablesObjectPtr objects[MAGAZINE_SIZE];
+	};
+
+	using MagazinePtr = std::unique_ptr<Magazine>;
+
+	// Per thread front end: a loaded and a previous magazine, swapped before going to the depot.
+	struct ThreadCache {
+		ThreadCache()
+			: hits(0) {
+		}
+
+		~ThreadCache() {
+			auto pool = owner.lock();
+			if (pool) {
+				(*pool.get())->flushThreadCache(*this);
+			}
+		}
+
+		std::weak_ptr<GenericObjectPool<T, DeletePolicy>*> owner;
+		MagazinePtr pLoaded;
+		MagazinePtr pPrevious;
+		uint64_t hits;
+	};
+
+	static ThreadCache& threadCache() {
+		static thread_local ThreadCache cache;
+		return cache;
+	}
+
+	ThreadCache* acquireThreadCache();
+
+	void flushThreadCache(ThreadCache &cache);
+
+	void depositMagazine(MagazinePtr pMagazine);
+
+	MagazinePtr takeEmptyMagazine();
+
 	PoolablesObjectPtr allocateObject();
     std::shared_ptr<GenericObjectPool<T, DeletePolicy>*> pSharedThisPtr_;
 	platform::SList<PoolablesObjectPtr> pFreelist_;
+	platform::SList<MagazinePtr> fullMagazines_;
+	platform::SList<MagazinePtr> emptyMagazines_;
+	std::atomic<uint32_t> depotCount_;
+	std::atomic<uint64_t> hits_;
+	std::atomic<uint64_t> depotHits_;
+	std::atomic<uint64_t> misses_;
 };
 
 template <typename T, typename DeletePolicy>
 GenericObjectPool<T, DeletePolicy>::GenericObjectPool()
-    : pSharedThisPtr_(new GenericObjectPool<T, DeletePolicy>*(this)) {
+    : pSharedThisPtr_(new GenericObjectPool<T, DeletePolicy>*(this))
+	, depotCount_(0)
+	, hits_(0)
+	, depotHits_(0)
+	, misses_(0) {
 	// allocate Vۤv, ΨӦ@ɵҦpooled object
 }
 
+template <typename T, typename DeletePolicy>
+GenericObjectPool<T, DeletePolicy>::~GenericObjectPool() {
+	// Objects still pooled in the depot must be deleted, not returned to a pool being destroyed.
+	destory();
+}
+
 template <typename T, typename DeletePolicy>
 void GenericObjectPool<T, DeletePolicy>::expand(uint32_t poolSize) {
+	// Pre-filled objects go to the depot as full magazines, any thread can pick them up.
+	while (poolSize >= MAGAZINE_SIZE) {
+		auto pMagazine = takeEmptyMagazine();
+		while (!pMagazine->isFull()) {
+			pMagazine->objects[pMagazine->size++] = allocateObject();
+		}
+		depositMagazine(std::move(pMagazine));
+		poolSize -= MAGAZINE_SIZE;
+	}
 	for (uint32_t i = 0; i < poolSize; ++i) {
-		returnObject(allocateObject());
+		pFreelist_.enqueue(allocateObject());
 	}
 }
 
@@ -87,27 +184,150 @@ void GenericObjectPool<T, DeletePolicy>::destory() {
 	pSharedThisPtr_.reset();
 }
 
+template <typename T, typename DeletePolicy>
+typename GenericObjectPool<T, DeletePolicy>::ThreadCache*
+GenericObjectPool<T, DeletePolicy>::acquireThreadCache() {
+	auto &cache = threadCache();
+	// Compare the control blocks: the weak reference keeps a destroyed pool's block from being reused
+	// by a new pool at the same address, and neither check writes the shared counts.
+	if (!cache.owner.owner_before(pSharedThisPtr_) && !pSharedThisPtr_.owner_before(cache.owner)) {
+		return &cache;
+	}
+	if (!cache.owner.expired()) {
+		// This thread already caches for another pool of the same type, use the depot directly.
+		return nullptr;
+	}
+	// Previous owner is gone, its objects delete themselves.
+	cache.pLoaded.reset();
+	cache.pPrevious.reset();
+	cache.owner = pSharedThisPtr_;
+	cache.hits = 0;
+	return &cache;
+}
+
+template <typename T, typename DeletePolicy>
+void GenericObjectPool<T, DeletePolicy>::flushThreadCache(ThreadCache &cache) {
+	hits_.fetch_add(cache.hits, std::memory_order_relaxed);
+	cache.hits = 0;
+	if (cache.pLoaded) {
+		depositMagazine(std::move(cache.pLoaded));
+	}
+	if (cache.pPrevious) {
+		depositMagazine(std::move(cache.pPrevious));
+	}
+}
+
+template <typename T, typename DeletePolicy>
+void GenericObjectPool<T, DeletePolicy>::depositMagazine(MagazinePtr pMagazine) {
+	if (pMagazine->isEmpty()) {
+		emptyMagazines_.enqueue(std::move(pMagazine));
+		return;
+	}
+	depotCount_.fetch_add(pMagazine->size, std::memory_order_relaxed);
+	fullMagazines_.enqueue(std::move(pMagazine));
+}
+
+template <typename T, typename DeletePolicy>
+typename GenericObjectPool<T, DeletePolicy>::MagazinePtr
+GenericObjectPool<T, DeletePolicy>::takeEmptyMagazine() {
+	MagazinePtr pMagazine;
+	if (!emptyMagazines_.tryDequeue(pMagazine)) {
+		pMagazine.reset(new Magazine());
+	}
+	return pMagazine;
+}
+
 template <typename T, typename DeletePolicy>
 void GenericObjectPool<T, DeletePolicy>::returnObject(PoolablesObjectPtr pObj) {
-	pFreelist_.enqueue(std::move(pObj));
+	auto pCache = acquireThreadCache();
+	if (!pCache) {
+		pFreelist_.enqueue(std::move(pObj));
+		return;
+	}
+
+	if (!pCache->pLoaded) {
+		pCache->pLoaded = takeEmptyMagazine();
+	}
+
+	if (pCache->pLoaded->isFull()) {
+		if (pCache->pPrevious && !pCache->pPrevious->isFull()) {
+			std::swap(pCache->pLoaded, pCache->pPrevious);
+		} else {
+			// Both magazines full: hand one to the depot and continue with an empty one.
+			hits_.fetch_add(pCache->hits, std::memory_order_relaxed);
+			pCache->hits = 0;
+			if (pCache->pPrevious) {
+				depositMagazine(std::move(pCache->pPrevious));
+			}
+			pCache->pPrevious = std::move(pCache->pLoaded);
+			pCache->pLoaded = takeEmptyMagazine();
+		}
+	}
+
+	auto &magazine = *pCache->pLoaded;
+	magazine.objects[magazine.size++] = std::move(pObj);
 }
 
 template <typename T, typename DeletePolicy>
 typename GenericObjectPool<T, DeletePolicy>::PoolablesObjectPtr
 GenericObjectPool<T, DeletePolicy>::borrowObject() {
 	PoolablesObjectPtr tmp;
+
+	auto pCache = acquireThreadCache();
+	if (pCache) {
+		if (!pCache->pLoaded || pCache->pLoaded->isEmpty()) {
+			if (pCache->pPrevious && !pCache->pPrevious->isEmpty()) {
+				std::swap(pCache->pLoaded, pCache->pPrevious);
+			} else {
+				// Both magazines empty: exchange one for a full magazine from the depot.
+				MagazinePtr pFull;
+				if (fullMagazines_.tryDequeue(pFull)) {
+					depotCount_.fetch_sub(pFull->size, std::memory_order_relaxed);
+					hits_.fetch_add(pCache->hits, std::memory_order_relaxed);
+					pCache->hits = 0;
+					if (pCache->pPrevious) {
+						emptyMagazines_.enqueue(std::move(pCache->pPrevious));
+					}
+					pCache->pPrevious = std::move(pCache->pLoaded);
+					pCache->pLoaded = std::move(pFull);
+					depotHits_.fetch_add(1, std::memory_order_relaxed);
+					auto &magazine = *pCache->pLoaded;
+					return std::move(magazine.objects[--magazine.size]);
+				}
+			}
+		}
+
+		if (pCache->pLoaded && !pCache->pLoaded->isEmpty()) {
+			++pCache->hits;
+			auto &magazine = *pCache->pLoaded;
+			return std::move(magazine.objects[--magazine.size]);
+		}
+	}
+
 	if (pFreelist_.tryDequeue(tmp)) {
+		depotHits_.fetch_add(1, std::memory_order_relaxed);
 		return tmp;
 	}
+	misses_.fetch_add(1, std::memory_order_relaxed);
 	return allocateObject();
 }
 
+template <typename T, typename DeletePolicy>
+typename GenericObjectPool<T, DeletePolicy>::PoolStats
+GenericObjectPool<T, DeletePolicy>::stats() const noexcept {
+	PoolStats stats;
+	stats.hits = hits_.load(std::memory_order_relaxed);
+	stats.depotHits = depotHits_.load(std::memory_order_relaxed);
+	stats.misses = misses_.load(std::memory_order_relaxed);
+	return stats;
+}
+
 template <typename T, typename DeletePolicy>
 typename GenericObjectPool<T, DeletePolicy>::PoolablesObjectPtr 
 GenericObjectPool<T, DeletePolicy>::allocateObject() {
 	// tm@pooled objectɭԴNǤJdeleter, object destructork٪!
 	return PoolablesObjectPtr(new T(), DefaultObjectDeleter {
-		std::weak_ptr<GenericObjectPool<T, DeletePolicy>*>{ pSharedThisPtr_ }
+		this, std::weak_ptr<GenericObjectPool<T, DeletePolicy>*>{ pSharedThisPtr_ }
 	});
 }
 
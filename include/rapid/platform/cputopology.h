@@ -0,0 +1,71 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <rapid/platform/platform.h>
+#include <rapid/utils/singleton.h>
+
+namespace rapid {
+
+namespace platform {
+
+struct ProcessorCore {
+	uint32_t node;
+	uint16_t group;
+	// Logical processors of the core in its group, more than one with SMT.
+	KAFFINITY processorMask;
+};
+
+struct ThreadPlacement {
+	// One logical processor per worker thread.
+	std::vector<GROUP_AFFINITY> workers;
+	// Shared by the accept poller and the logging thread, an empty mask leaves them unpinned.
+	GROUP_AFFINITY housekeeping;
+};
+
+// Physical cores and NUMA nodes of the machine, read once with GetLogicalProcessorInformationEx so
+// processor groups beyond 64 logical processors are covered.
+class CpuTopology : public utils::Singleton<CpuTopology> {
+public:
+	CpuTopology();
+
+	// Ordered by node, then group and first logical processor.
+	std::vector<ProcessorCore> const & getCores() const noexcept;
+
+	std::vector<ProcessorCore> getNodeCores(uint32_t node) const;
+
+	uint32_t getNumaNodeCount() const noexcept;
+
+	// Nodes with at least one core, in ascending order.
+	std::vector<uint32_t> getNumaNodes() const;
+
+	// Every logical processor of node in the processor group of its first core.
+	GROUP_AFFINITY getNodeAffinity(uint32_t node) const;
+
+	// Give each of numWorkers threads a distinct physical core of node, after the first numHousekeepingCores
+	// cores which are left to the housekeeping threads. Once every core has a worker, the other hardware
+	// threads of the cores are handed out if useSmtSiblings is set, otherwise the cores are shared.
+	ThreadPlacement placeThreads(uint32_t node, uint32_t numWorkers, uint32_t numHousekeepingCores, bool useSmtSiblings) const;
+
+private:
+	uint32_t numNodes_;
+	std::vector<ProcessorCore> cores_;
+};
+
+__forceinline std::vector<ProcessorCore> const & CpuTopology::getCores() const noexcept {
+	return cores_;
+}
+
+__forceinline uint32_t CpuTopology::getNumaNodeCount() const noexcept {
+	return numNodes_;
+}
+
+}
+
+}
@@ -33,9 +33,9 @@ private:
 template <typename R, typename... T>
 class DLLAPI final {
 public:
-    DLLAPI(std::string const &dllName, std::string const &functionName) {
-        pDllPfn_ = static_cast<R(__stdcall * const)(T...)>(
-			DLLMap::getInstance().getProcAddress(dllName, functionName.c_str()));
+    DLLAPI(std::string const &dllName, std::string const &functionName)
+		: pDllPfn_(reinterpret_cast<R(__stdcall *)(T...)>(
+			DLLMap::getInstance().getProcAddress(dllName, functionName))) {
     }
 
 	__forceinline bool valid() noexcept {
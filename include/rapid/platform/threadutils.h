@@ -37,6 +37,10 @@ void getThreadCpuUsage(uint32_t threadId, ThreadCpuUsage &usage);
 
 uint32_t getThreadId(std::thread const * thread);
 
+void setThreadAffinity(std::thread* thread, GROUP_AFFINITY const &affinity);
+
+void setCurrentThreadAffinity(GROUP_AFFINITY const &affinity);
+
 }
 
 }
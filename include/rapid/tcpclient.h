@@ -0,0 +1,83 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <rapid/platform/spinlock.h>
+#include <rapid/eventhandler.h>
+
+namespace rapid {
+
+namespace details {
+class IoEventDispatcher;
+class BlockFactory;
+class SocketAddress;
+
+class TimingWheel;
+using TimingWheelPtr = std::shared_ptr<TimingWheel>;
+}
+
+class TcpClient;
+using TcpClientPtr = std::shared_ptr<TcpClient>;
+
+// Outbound connections running on an IoEventDispatcher, their buffers come from the given BlockFactory.
+// Sockets are reused through DisconnectEx like accepted ones, and connections given back with release
+// are kept alive per upstream address for the next connect to the same address. The client owns every
+// connection it created, the handles given to the handlers stay valid until close.
+class TcpClient : public std::enable_shared_from_this<TcpClient> {
+public:
+	static TcpClientPtr createTcpClient(details::IoEventDispatcher &dispatcher,
+		std::shared_ptr<details::BlockFactory> pBlockFactory,
+		uint32_t maxSocketCount);
+
+	TcpClient(details::IoEventDispatcher &dispatcher,
+		std::shared_ptr<details::BlockFactory> pBlockFactory,
+		uint32_t maxSocketCount);
+
+	~TcpClient();
+
+	TcpClient(TcpClient const &) = delete;
+	TcpClient& operator=(TcpClient const &) = delete;
+
+	// Get a connection to remoteAddress, an idle keep-alive connection is handed out first.
+	// The handler runs on the calling thread when no connect is needed or it completes synchronously,
+	// otherwise on an IO thread of the dispatcher. If the connect failed the connection is already
+	// taken back and must not be used. Throws if all sockets are in use.
+	void connect(details::SocketAddress const &remoteAddress, ConnectEventHandler handler);
+
+	// Give back a connection with no pending IO for reuse with the same upstream.
+	// The upstream may close an idle connection, the next read on it then reports the disconnect.
+	void release(ConnectionHandle pConn);
+
+	void setMaxIdlePerUpstream(uint32_t maxIdleCount);
+
+	void close();
+
+private:
+	static uint32_t constexpr DEFAULT_MAX_IDLE_PER_UPSTREAM = 32;
+
+	ConnectionPtr acquireSocket();
+
+	void onSocketReuse(ConnectionHandle &pConn);
+
+	details::IoEventDispatcher *pDispatcher_;
+	std::shared_ptr<details::BlockFactory> pBlockFactory_;
+	details::TimingWheelPtr pReuseTimingWheel_;
+	uint32_t maxSocketCount_;
+	uint32_t socketCount_;
+	uint32_t maxIdlePerUpstream_;
+	platform::Spinlock lock_;
+	std::vector<ConnectionPtr> sockets_;
+	std::vector<ConnectionPtr> freeSockets_;
+	std::unordered_map<std::string, std::vector<ConnectionPtr>> idleConnections_;
+};
+
+}
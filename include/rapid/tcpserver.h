@@ -7,21 +7,37 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 
 #include <rapid/eventhandler.h>
+#include <rapid/tcpclient.h>
 
 namespace rapid {
 
+namespace platform {
+struct ThreadPlacement;
+}
+
 namespace details {
 class IoEventDispatcher;
 class IoThreadPool;
 class SocketAcceptPooller;
 class TcpServerSocket;
 class BlockFactory;
+class IoShard;
+struct IoWaitStats;
 }
 
+struct DrainProgress {
+	size_t totalConnections;
+	size_t closedConnections;
+};
+
 class TcpServer {
 public:
+	// Pass as the NUMA node of startListening to serve from every node.
+	static uint16_t constexpr ALL_NUMA_NODES = 0xFFFF;
+
     explicit TcpServer(uint16_t localPort);
 
     TcpServer(std::string const &localAddress, uint16_t localPort);
@@ -30,26 +46,94 @@ public:
 
     ~TcpServer();
 
+	// With ALL_NUMA_NODES every node runs its own worker group and block factory (the setShardCount shards
+	// are split across the nodes, at least one each), the threads of a group stay on its node, so a connection only uses memory of the node
+	// whose shard it belongs to.
 	void startListening(ContextEventHandler &&callback, uint16_t numaNode = 0);
 
     void shutdown();
 
+	// Stop accepting and close each connection once it has finished its current request, waiting at
+	// most timeout milliseconds. Returns true if every connection has been closed, shutdown then no
+	// longer cuts any response. Outbound connections of the TcpClients are not drained.
+	bool drain(uint32_t timeout);
+
+	DrainProgress getDrainProgress() const;
+
     void setSocketPool(uint16_t scaleSocketSize, uint16_t poolSocketSize, size_t bufferSize);
 
+	// Split the server into independent shards (completion queue, worker threads, buffer pool and
+	// connection pool each), a connection stays on the shard that accepted it. Must be called before
+	// startListening, the default of 1 keeps a single queue shared by all worker threads.
+	void setShardCount(uint32_t shardCount);
+
+	// Reserve buffers for clientSocketSize outbound sockets, spread over the shards like the socket pool.
+	// Must be called before startListening.
+	void setClientSocketPool(uint16_t clientSocketSize);
+
+	// The TcpClient of the shard pConn runs on, its connections complete on the same IO threads.
+	// Returns nullptr if no client socket pool has been set.
+	TcpClientPtr getTcpClient(ConnectionHandle pConn) const;
+
+	// Opt-in low latency mode: every IO worker busy polls its completion queue for busyPollTime
+	// microseconds before it blocks, keeping a core busy while the server is idle. Must be called
+	// before startListening, the default of 0 blocks at once.
+	void setBusyPollTime(uint32_t busyPollTime);
+
+	// Back the buffer pool of every shard with large pages, fewer TLB misses on large pools at the cost
+	// of committing the whole pool up front. Needs SE_LOCK_MEMORY_NAME, without it or with too few free
+	// large pages the pool falls back to small pages. Must be called before startListening.
+	void setLargePages(bool enable);
+
+	// Budget of the memory committed by the process for connection buffers, file cache and request
+	// arenas. Above softLimit the socket pool stops growing and pooled sockets give back their grown
+	// pages at once; close to hardLimit new connections are refused and the connections with the
+	// largest buffers are closed; at hardLimit buffers can't grow anymore, which closes the connection
+	// that asked. 0 disables a limit. The budget is process wide, shared by every server.
+	void setMemoryLimit(uint64_t softLimit, uint64_t hardLimit);
+
+	// Wait counters of every IO worker thread, shard by shard, to tune the busy poll time.
+	std::vector<details::IoWaitStats> getIoWaitStats() const;
+
+	// Pin every IO worker thread to its own physical core of the NUMA node given to startListening, its
+	// buffers then stay local to the core. The first numHousekeepingCores cores of the node are left to
+	// the accept poller and the logging thread. Once every other core has a worker, further workers take
+	// the SMT siblings if useSmtSiblings is set, otherwise they share the cores. Must be called before
+	// startListening, by default the threads are left to the scheduler.
+	void setThreadPlacement(uint32_t numHousekeepingCores, bool useSmtSiblings);
+
 private:
 	static uint32_t constexpr SYSTEM_PAGE_SIZE = 64 * 1024;
 
     void setProcessAffinity() const;
 
-    void startThreadPool();
+	struct WorkerGroup;
+
+	uint32_t getConcurrentThreadCount(uint16_t numaNode) const;
+
+	std::vector<WorkerGroup> planWorkerGroups() const;
+
+    void startThreadPool(std::vector<WorkerGroup> const &groups);
 	
 	uint16_t localPort_;
 	uint16_t numNumaNode_;
+	uint16_t scaleSocketSize_;
+	uint16_t poolSocketSize_;
+	uint16_t clientSocketSize_;
 	uint32_t numThreadPerCpu_;
+	uint32_t numShards_;
+	uint32_t busyPollTime_;
+	bool isAllNumaNodes_;
+	bool isThreadPinned_;
+	bool useSmtSiblings_;
+	bool useLargePages_;
+	uint32_t numHousekeepingCores_;
+	size_t bufferSize_;
 	std::string localAddress_;
     std::shared_ptr<details::TcpServerSocket> pListenSocket_;
     std::shared_ptr<details::SocketAcceptPooller> pSocketAcceptPooller_;
-    std::shared_ptr<details::IoThreadPool> pThreadPool_;
+    std::vector<std::shared_ptr<details::IoShard>> shards_;
+	std::vector<TcpClientPtr> clients_;
 };
 
 }
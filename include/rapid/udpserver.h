@@ -0,0 +1,93 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace rapid {
+
+namespace details {
+class IoEventDispatcher;
+class BlockFactory;
+class SocketAddress;
+class UdpSocket;
+}
+
+class UdpServer;
+class DatagramReceiver;
+class RegisteredDatagramReceiver;
+
+using DatagramEventHandler = std::function<void(UdpServer &server,
+	details::SocketAddress const &remoteAddress,
+	char const *data,
+	uint32_t length)>;
+
+// Datagram socket served by the IO threads of an IoEventDispatcher. Several WSARecvFrom requests are
+// kept outstanding, each one into its own BlockFactory block, so a burst of datagrams completes as one
+// batch of completion packets. Datagrams already queued in the socket are drained without going back
+// to the completion queue.
+//
+// With Registered I/O the block pool is registered with the kernel once and the receives refer to
+// their block by buffer id and offset, which saves the page locking of every receive at high packet
+// rates. The receives then complete into a RIO completion queue that notifies the dispatcher.
+class UdpServer {
+public:
+	explicit UdpServer(uint16_t localPort);
+
+	UdpServer(std::string const &localAddress, uint16_t localPort);
+
+	// Serve on dispatcher instead of the process-wide IoEventDispatcher, e.g. the one of a TcpServer shard.
+	UdpServer(std::string const &localAddress, uint16_t localPort, details::IoEventDispatcher &dispatcher);
+
+	~UdpServer();
+
+	UdpServer(UdpServer const &) = delete;
+	UdpServer& operator=(UdpServer const &) = delete;
+
+	// Call it on a dispatcher that already has worker threads, the handler runs on them.
+	void startListening(DatagramEventHandler &&handler, uint32_t numOutstanding = DEFAULT_OUTSTANDING_RECEIVES, uint16_t numaNode = 0);
+
+	// Receive with Registered I/O, must be called before startListening. Falls back to WSARecvFrom if
+	// the system has no RIO support or the dispatcher doesn't run on an I/O completion port. Datagrams
+	// larger than MAX_DATAGRAM_SIZE less the remote address are dropped in this mode.
+	void setRegisteredIo(bool enable);
+
+	void sendTo(details::SocketAddress const &remoteAddress, char const *data, uint32_t length) const;
+
+	void shutdown();
+
+private:
+	friend class DatagramReceiver;
+	friend class RegisteredDatagramReceiver;
+
+	static uint32_t constexpr DEFAULT_OUTSTANDING_RECEIVES = 64;
+	static uint32_t constexpr MAX_DATAGRAM_SIZE = 64 * 1024;
+
+	void startReceive(DatagramReceiver *pReceiver);
+
+	void receiveLoop(DatagramReceiver *pReceiver, uint32_t bytesTransferred);
+
+	bool startRegisteredIo(uint32_t numOutstanding);
+
+	void onDatagram(details::SocketAddress const &remoteAddress, char const *data, uint32_t length);
+
+	std::atomic<bool> isRunning_;
+	bool useRegisteredIo_;
+	std::atomic<uint32_t> activeReceivers_;
+	details::IoEventDispatcher *pDispatcher_;
+	std::unique_ptr<details::UdpSocket> pSocket_;
+	std::shared_ptr<details::BlockFactory> pBlockFactory_;
+	std::vector<std::unique_ptr<DatagramReceiver>> receivers_;
+	std::unique_ptr<RegisteredDatagramReceiver> pRegisteredReceiver_;
+	DatagramEventHandler handler_;
+};
+
+}
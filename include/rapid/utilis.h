@@ -84,7 +84,7 @@ static inline void format(IoBuffer * __restrict pBuffer, char const * __restrict
 	va_end(args);
 }
 
-static inline bool readUntil(ConnectionPtr pConn, std::ostream &stream, uint32_t totalSize) {
+static inline bool readUntil(ConnectionHandle pConn, std::ostream &stream, uint32_t totalSize) {
 	auto *pBuffer = pConn->getReceiveBuffer();
 	uint32_t readableBytes = 0;
 	uint32_t writtenSize = 0;
@@ -102,11 +102,11 @@ static inline bool readUntil(ConnectionPtr pConn, std::ostream &stream, uint32_t
 		RAPID_ENSURE(writtenSize < totalSize);
 		readableBytes = totalSize - writtenSize;
 		readableBytes = (std::min)(static_cast<uint32_t>(pBuffer->goodSize()), readableBytes);
-	} while (pBuffer->readSome(pConn->shared_from_this(), readableBytes));
+	} while (pBuffer->readSome(pConn, readableBytes));
 	return false;
 }
 
-static inline bool readUntil(ConnectionPtr pConn, uint32_t &writtenSize, uint32_t totalSize,
+static inline bool readUntil(ConnectionHandle pConn, uint32_t &writtenSize, uint32_t totalSize,
 	std::function<void(char const *, size_t)> parseCallback) {
 	auto *pBuffer = pConn->getReceiveBuffer();
 	uint32_t readableBytes = 0;
@@ -126,7 +126,7 @@ static inline bool readUntil(ConnectionPtr pConn, uint32_t &writtenSize, uint32_
 		RAPID_ENSURE(writtenSize < totalSize);
 		readableBytes = totalSize - writtenSize;
 		readableBytes = (std::min)(static_cast<uint32_t>(pBuffer->goodSize()), readableBytes);
-	} while (pBuffer->readSome(pConn->shared_from_this(), readableBytes));
+	} while (pBuffer->readSome(pConn, readableBytes));
 	return false;
 }
 
@@ -0,0 +1,153 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <rapid/details/memorygovernor.h>
+
+namespace rapid {
+
+namespace utils {
+
+// Bump allocator for objects whose lifetime ends at a well known boundary (e.g. one HTTP request).
+// Memory is never returned piecemeal, reset() rewinds every chunk at once and keeps them for the
+// next round, so a warmed-up arena serves allocations without touching the heap. Not thread-safe.
+// Chunks are charged to the memory governor, std::bad_alloc is thrown once it refuses one.
+class MonotonicArena {
+public:
+	static size_t constexpr DEFAULT_CHUNK_SIZE = 4 * 1024;
+
+	explicit MonotonicArena(size_t chunkSize = DEFAULT_CHUNK_SIZE)
+		: chunkSize_(chunkSize)
+		, current_(0)
+		, offset_(0) {
+	}
+
+	~MonotonicArena() {
+		for (auto &chunk : chunks_) {
+			std::free(chunk.first);
+			details::MemoryGovernor::getInstance().release(details::MEMORY_ARENA, chunk.second);
+		}
+	}
+
+	MonotonicArena(MonotonicArena const &) = delete;
+	MonotonicArena& operator=(MonotonicArena const &) = delete;
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+		for (; current_ < chunks_.size(); ++current_, offset_ = 0) {
+			auto const start = alignUp(offset_, alignment);
+			if (start + size <= chunks_[current_].second) {
+				offset_ = start + size;
+				return chunks_[current_].first + start;
+			}
+		}
+		return allocateChunk(size);
+	}
+
+	void reset() noexcept {
+		current_ = 0;
+		offset_ = 0;
+	}
+
+	size_t capacity() const noexcept {
+		size_t total = 0;
+		for (auto const &chunk : chunks_) {
+			total += chunk.second;
+		}
+		return total;
+	}
+
+private:
+	static __forceinline size_t alignUp(size_t value, size_t alignment) noexcept {
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	void* allocateChunk(size_t size) {
+		auto const chunkSize = (std::max)(size, chunkSize_);
+		if (!details::MemoryGovernor::getInstance().tryCharge(details::MEMORY_ARENA, chunkSize)) {
+			throw std::bad_alloc();
+		}
+		auto chunk = static_cast<char*>(std::malloc(chunkSize));
+		if (!chunk) {
+			details::MemoryGovernor::getInstance().release(details::MEMORY_ARENA, chunkSize);
+			throw std::bad_alloc();
+		}
+		chunks_.emplace_back(chunk, chunkSize);
+		current_ = chunks_.size() - 1;
+		offset_ = size;
+		return chunk;
+	}
+
+	size_t chunkSize_;
+	size_t current_;
+	size_t offset_;
+	std::vector<std::pair<char*, size_t>> chunks_;
+};
+
+// Stateful allocator over a MonotonicArena, the std::pmr::polymorphic_allocator idea for a
+// compiler without <memory_resource>. deallocate() is a no-op; the owner resets the arena.
+template <typename T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	ArenaAllocator() noexcept
+		: arena_(nullptr) {
+	}
+
+	explicit ArenaAllocator(MonotonicArena *arena) noexcept
+		: arena_(arena) {
+	}
+
+	template <typename U>
+	ArenaAllocator(ArenaAllocator<U> const &other) noexcept
+		: arena_(other.arena()) {
+	}
+
+	T* allocate(size_t n) {
+		if (!arena_) {
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+		return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+	}
+
+	void deallocate(T *p, size_t) noexcept {
+		if (!arena_) {
+			::operator delete(p);
+		}
+	}
+
+	MonotonicArena* arena() const noexcept {
+		return arena_;
+	}
+
+private:
+	MonotonicArena *arena_;
+};
+
+template <typename T, typename U>
+__forceinline bool operator==(ArenaAllocator<T> const &lhs, ArenaAllocator<U> const &rhs) noexcept {
+	return lhs.arena() == rhs.arena();
+}
+
+template <typename T, typename U>
+__forceinline bool operator!=(ArenaAllocator<T> const &lhs, ArenaAllocator<U> const &rhs) noexcept {
+	return !(lhs == rhs);
+}
+
+using ArenaString = std::basic_string<char, std::char_traits<char>, ArenaAllocator<char>>;
+
+}
+
+}
@@ -4,12 +4,14 @@
 //---------------------------------------------------------------------------------------------------------------------
 
 #include <rapid/exception.h>
+#include <rapid/utils/scopeguard.h>
 #include <rapid/platform/utils.h>
 #include <rapid/platform/tcpipparameters.h>
 
 #include <rapid/logging/logging.h>
 
 #include <rapid/details/timingwheel.h>
+#include <rapid/details/deadlinewheel.h>
 #include <rapid/details/contracts.h>
 #include <rapid/details/ioeventdispatcher.h>
 #include <rapid/details/wasextapi.h>
@@ -19,17 +21,17 @@
 
 namespace rapid {
 
-static void defaultAcceptConnection(ConnectionPtr pConn) {
+static void defaultAcceptConnection(ConnectionHandle pConn) {
     pConn->sendAndDisconnec();
 }
 
-static void defaultRecvComplete(ConnectionPtr) {
+static void defaultRecvComplete(ConnectionHandle) {
 }
 
-static void defaultSendComplete(ConnectionPtr) {
+static void defaultSendComplete(ConnectionHandle) {
 }
 
-static void defaultDisconnectComplete(ConnectionPtr) {
+static void defaultDisconnectComplete(ConnectionHandle) {
 }
 
 static void setSocketOption(details::TcpSocket &pSocket) {
@@ -68,13 +70,28 @@ Connection::AcceptBufferSize::AcceptBufferSize(uint32_t acceptBufferSize) noexce
 	, recvLen(acceptBufferSize - IPV6_ACCEPT_SOCKADDR_SIZE) {
 }
 
-Connection::Connection(details::TcpServerSocket *listenSocket, details::BlockFactory &factory, details::TimingWheelPtr reuseTimingWheel)
+Connection::Connection(details::IoEventDispatcher &dispatcher,
+	details::TcpServerSocket *listenSocket,
+	details::BlockFactory &factory,
+	details::TimingWheelPtr reuseTimingWheel)
 	: isReuseSocket_(false)
-	, hasUpdataAcceptContext_(true)
 	, isSendShutdown_(false)
 	, isRecvShutdown_(false)
+	, isSendPending_(false)
+	, isSocketBound_(false)
+	, isAboveHighWatermark_(false)
+	, isReadPaused_(false)
+	, isRecvPending_(false)
+	, isAborting_(false)
+	, isDraining_(false)
+	, isRetiring_(false)
+	, isRequestActive_(false)
+	, isPooled_(false)
+	, isReclaiming_(false)
+	, hasUpdataAcceptContext_(true)
 	, lastOptFlags_(details::IOFlags::IO_ACCEPT_PENDDING)
 	, halfClosedState_(ACTIVE_CLOSE)
+	, pDispatcher_(&dispatcher)
 	, pListenSocket_(listenSocket)
 	, pTimeWaitReuseTimer_(reuseTimingWheel)
 	, pAcceptBuffer_(std::make_unique<IoBuffer>())
@@ -82,11 +99,27 @@ Connection::Connection(details::TcpServerSocket *listenSocket, details::BlockFac
 	, pReceiveBuffer_(std::make_unique<IoBuffer>(0, factory))
 	, pPostBuffer_(std::make_unique<IoBuffer>())
 	, pDisconnectBuffer_(std::make_unique<IoBuffer>())
+	, sendFileHandle_(INVALID_HANDLE_VALUE)
+	, sendFileOffset_(0)
+	, sendFileRemaining_(0)
+	, sendBufferBytes_(0)
+	, sendFileBytes_(0)
+	, lowWatermark_(0)
+	, highWatermark_(0)
+	, lastActivityTime_(0)
+	, acceptCount_(0)
+	, bufferSize_(0)
 	, acceptSize_(pReceiveBuffer_->size()) {
+	memset(&transmitBuffers_, 0, sizeof(transmitBuffers_));
+	memset(timeouts_, 0, sizeof(timeouts_));
+	memset(deadlineGenerations_, 0, sizeof(deadlineGenerations_));
 	pAcceptBuffer_->setCompleteHandler(defaultAcceptConnection);
 	pSendBuffer_->setCompleteHandler(defaultSendComplete);
 	pReceiveBuffer_->setCompleteHandler(defaultRecvComplete);
 	pDisconnectBuffer_->setCompleteHandler(defaultDisconnectComplete);
+	pSendBuffer_->chargeSizeTo(bufferSize_);
+	pReceiveBuffer_->chargeSizeTo(bufferSize_);
+	pPostBuffer_->ioFlag = details::IOFlags::IO_POST_PENDDING;
 	// ʽ: ݭnftSE_LOCK_MEMORY_NAME
 #ifdef ENABLE_LOCK_MEMORY
 	//pReceiveBuffer_->lockOverlappedRange(acceptSocket_);
@@ -107,15 +140,16 @@ void Connection::updateAcceptContext() {
 
     hasUpdataAcceptContext_ = true;
     if (!isReuseSocket_) {
-		details::IoEventDispatcher::getInstance().addDevice(acceptSocket_.handle(), reinterpret_cast<ULONG_PTR>(this));
+		pDispatcher_->addDevice(acceptSocket_.handle(), reinterpret_cast<ULONG_PTR>(this));
     }
 }
 
-void Connection::postAsync(std::function<void(ConnectionPtr)> handler) {
+void Connection::postAsync(std::function<void(ConnectionHandle)> handler) {
 	RAPID_TRACE_CALL();
-	pPostBuffer_->setCompleteHandler(handler);
-	pPostBuffer_->ioFlag = details::IOFlags::IO_POST_PENDDING;
-	details::IoEventDispatcher::getInstance().post(reinterpret_cast<ULONG_PTR>(this), pPostBuffer_.get());
+	// Only the post onto an empty queue queues the completion packet, so pPostBuffer_ is never in flight twice.
+	if (postTasks_.push(std::move(handler))) {
+		pDispatcher_->post(reinterpret_cast<ULONG_PTR>(this), pPostBuffer_.get());
+	}
 }
 
 bool Connection::acceptAsync() {
@@ -125,7 +159,12 @@ bool Connection::acceptAsync() {
 	lastOptFlags_ = details::IOFlags::IO_ACCEPT_PENDDING;
 	halfClosedState_ = ACTIVE_CLOSE;
     pSendBuffer_->reset();
-    pReceiveBuffer_->reset();
+	// AcceptEx receives into the linear block, the ring of an upgraded connection ends here.
+    pReceiveBuffer_->releaseRingBuffer();
+	resetSendState();
+	resetDeadlines();
+	// Only the first page of the receive buffer takes the accept data, the rest may be reclaimed.
+	isPooled_ = true;
 	
 	auto tryToAccepNewConn = true;
 
@@ -169,28 +208,118 @@ bool Connection::acceptAsync() {
 	return false;
 }
 
-bool Connection::sendFileAsync(HANDLE fileHandle, uint64_t offset, uint32_t numberOfBytesToWrite) {
-    pSendBuffer_->reset();
-	pSendBuffer_->Offset = static_cast<DWORD>(offset);
-	pSendBuffer_->OffsetHigh = static_cast<DWORD>(offset >> 32);
-    
-	lastOptFlags_ = details::IOFlags::IO_SEND_FILE_PENDDING;
+bool Connection::connectAsync(details::SocketAddress const &remoteAddress) {
+	RAPID_ENSURE(pListenSocket_ == nullptr);
+	RAPID_ENSURE(hasUpdataAcceptContext_ == true);
+
+	if (!isSocketBound_) {
+		// ConnectEx requires a bound socket, a reused socket keeps its binding.
+		acceptSocket_.setLocalPort(0);
+		pDispatcher_->addDevice(acceptSocket_.handle(), reinterpret_cast<ULONG_PTR>(this));
+		isSocketBound_ = true;
+	}
+
+	halfClosedState_ = ACTIVE_CLOSE;
+	isSendShutdown_ = false;
+	isRecvShutdown_ = false;
+	pSendBuffer_->reset();
+	pReceiveBuffer_->releaseRingBuffer();
+	resetSendState();
+	resetDeadlines();
+	resetOverlappedValue();
+
+	lastOptFlags_ = details::IOFlags::IO_CONNECT_PENDDING;
+
+	DWORD bytesSent = 0;
+	auto retval = details::WsaExtAPI::getInstance().connectEx(acceptSocket_, remoteAddress, nullptr, 0, &bytesSent, this);
+	if (!retval && isReuseSocket_ && ::GetLastError() == WSAEINVAL) {
+		// Bind again if the socket lost its local address when it was reused.
+		acceptSocket_.setLocalPort(0);
+		retval = details::WsaExtAPI::getInstance().connectEx(acceptSocket_, remoteAddress, nullptr, 0, &bytesSent, this);
+	}
+
+	if (retval) {
+		lastOptFlags_ = details::IOFlags::IO_CONNECT_COMPLETED;
+		updateConnectContext();
+		startDeadline(IDLE_DEADLINE);
+		return true;
+	}
+
+	auto lastError = ::GetLastError();
+	if (lastError != ERROR_IO_PENDING) {
+		lastOptFlags_ = details::IOFlags::IO_CONNECT_COMPLETED;
+		throw Exception(lastError);
+	}
+	return false;
+}
+
+void Connection::updateConnectContext() {
+	if (::setsockopt(acceptSocket_.socketFd(), SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, nullptr, 0) < 0) {
+		throw Exception();
+	}
+	accpetedAddress_.localAddress = details::SocketAddress::getSockName(acceptSocket_.socketFd());
+	accpetedAddress_.remoteAddess = details::SocketAddress::getPeerName(acceptSocket_.socketFd());
+}
+
+void Connection::onConnected() {
+	RAPID_TRACE_CALL();
+
+	lastOptFlags_ = details::IOFlags::IO_CONNECT_COMPLETED;
+
+	// The completion packet doesn't carry the error, fetch it from the overlapped result.
+	DWORD bytesTransferred = 0;
+	DWORD flags = 0;
+	uint32_t error = ERROR_SUCCESS;
+	if (!::WSAGetOverlappedResult(acceptSocket_.socketFd(), this, &bytesTransferred, FALSE, &flags)) {
+		error = ::WSAGetLastError();
+	} else {
+		updateConnectContext();
+		startDeadline(IDLE_DEADLINE);
+	}
+
+	auto pThis = handle();
+	connectHandler_(pThis, error);
+}
+
+bool Connection::sendFileAsync(HANDLE fileHandle, uint64_t offset, uint32_t numberOfBytesToWrite, IoBuffer * __restrict pBuffer, uint32_t * __restrict numByteSend) {
+	RAPID_TRACE_CALL();
+
+	// The bytes of the send buffer go out in front of the file data.
+	LPTRANSMIT_FILE_BUFFERS pTransmitBuffers = nullptr;
+	if (!pBuffer->isEmpty()) {
+		transmitBuffers_.Head = pBuffer->peek();
+		transmitBuffers_.HeadLength = pBuffer->readable();
+		transmitBuffers_.Tail = nullptr;
+		transmitBuffers_.TailLength = 0;
+		pTransmitBuffers = &transmitBuffers_;
+	}
+
+	pBuffer->Offset = static_cast<DWORD>(offset);
+	pBuffer->OffsetHigh = static_cast<DWORD>(offset >> 32);
+	pBuffer->ioFlag = details::IOFlags::IO_SEND_FILE_PENDDING;
 
 	auto retval = details::WsaExtAPI::getInstance().transmitFile(acceptSocket_,
                                             fileHandle,
 											numberOfBytesToWrite,
                                             0,
-                                            pSendBuffer_.get(),
-                                            nullptr,
+                                            pBuffer,
+                                            pTransmitBuffers,
 											TF_USE_KERNEL_APC);
     if (retval) {
-        lastOptFlags_ = details::IOFlags::IO_SEND_FILE_COMPLETED;
+		pBuffer->ioFlag = details::IOFlags::IO_SEND_FILE_COMPLETED;
+		// Less than requested if the file ended first.
+		DWORD bytesTransferred = 0;
+		DWORD flags = 0;
+		if (!::WSAGetOverlappedResult(acceptSocket_.socketFd(), pBuffer, &bytesTransferred, FALSE, &flags)) {
+			throw Exception();
+		}
+		*numByteSend = bytesTransferred;
         return true;
     }
     
 	auto lastError = ::GetLastError();
     if (lastError != ERROR_IO_PENDING) {
-        throw Exception(lastError);
+		onConnectionError(lastError);
     }
     return false;
 }
@@ -198,6 +327,8 @@ bool Connection::sendFileAsync(HANDLE fileHandle, uint64_t offset, uint32_t numb
 bool Connection::disconnectAsync() {
     pSendBuffer_->reset();
     pReceiveBuffer_->reset();
+	resetSendState();
+	resetDeadlines();
     
 	resetOverlappedValue();
 
@@ -223,7 +354,402 @@ bool Connection::receiveAsync(char * __restrict buffer, uint32_t bufferLen, IoBu
 }
 
 bool Connection::sendAsync() {
-	return pSendBuffer_->send(shared_from_this());
+	return pSendBuffer_->send(handle());
+}
+
+void Connection::enqueueSend(char const *data, uint32_t length, std::shared_ptr<void const> pOwner) {
+	sendQueue_.push(data, length, std::move(pOwner));
+}
+
+void Connection::enqueueSend(IoSlice const &slice) {
+	sendQueue_.push(slice.data(), slice.size(), slice.owner());
+}
+
+bool Connection::sendFile(HANDLE fileHandle, uint64_t offset, uint64_t length) {
+	RAPID_ENSURE(!isSendPending_ && sendFileRemaining_ == 0);
+	// Queued segments would otherwise be sent after the file data.
+	RAPID_ENSURE(sendQueue_.isEmpty());
+
+	sendFileHandle_ = fileHandle;
+	sendFileOffset_ = offset;
+	sendFileRemaining_ = length;
+	return sendAsync();
+}
+
+bool Connection::hasPendingSend() const noexcept {
+	return isSendPending_
+		|| !pSendBuffer_->isEmpty()
+		|| !sendQueue_.isEmpty()
+		|| sendFileRemaining_ > 0;
+}
+
+void Connection::resetSendState() noexcept {
+	isSendPending_ = false;
+	isAboveHighWatermark_ = false;
+	isReadPaused_ = false;
+	sendQueue_.clear();
+	sendFileHandle_ = INVALID_HANDLE_VALUE;
+	sendFileOffset_ = 0;
+	sendFileRemaining_ = 0;
+	sendBufferBytes_ = 0;
+	sendFileBytes_ = 0;
+}
+
+void Connection::setWriteWatermarks(uint32_t lowWatermark, uint32_t highWatermark) {
+	RAPID_ENSURE(lowWatermark <= highWatermark);
+	lowWatermark_ = lowWatermark;
+	highWatermark_ = highWatermark;
+}
+
+uint64_t Connection::getPendingSendBytes() const noexcept {
+	// File data is read by the kernel as it goes out, only the buffered bytes hold memory.
+	return pSendBuffer_->readable() + sendQueue_.size();
+}
+
+bool Connection::isWritable() noexcept {
+	if (highWatermark_ == 0 || isAboveHighWatermark_) {
+		return !isAboveHighWatermark_;
+	}
+	isAboveHighWatermark_ = getPendingSendBytes() >= highWatermark_;
+	return !isAboveHighWatermark_;
+}
+
+bool Connection::pauseReadIfNotWritable() noexcept {
+	if (isWritable()) {
+		return false;
+	}
+	RAPID_LOG_TRACE() << "Pause read, " << getPendingSendBytes() << " bytes pending to send";
+	isReadPaused_ = true;
+	return true;
+}
+
+void Connection::checkLowWatermark() {
+	if (!isAboveHighWatermark_ || getPendingSendBytes() > lowWatermark_) {
+		return;
+	}
+
+	isAboveHighWatermark_ = false;
+
+	auto pThis = handle();
+	if (writableHandler_ != nullptr) {
+		writableHandler_(pThis);
+	}
+
+	if (isReadPaused_ && !isSendShutdown_ && !isRecvShutdown_) {
+		resumeRead();
+	}
+}
+
+void Connection::resumeRead() {
+	RAPID_TRACE_CALL();
+	isReadPaused_ = false;
+	auto pThis = handle();
+	if (pReceiveBuffer_->readSome(pThis)) {
+		pReceiveBuffer_->onComplete(pThis);
+	}
+}
+
+void Connection::setTimeout(DeadlineType type, uint32_t timeout) {
+	RAPID_ENSURE(type < MAX_DEADLINE_TYPE);
+	timeouts_[type] = timeout;
+}
+
+void Connection::startDeadline(DeadlineType type) {
+	RAPID_ENSURE(type < MAX_DEADLINE_TYPE);
+	auto const generation = ++deadlineGenerations_[type];
+	if (type == REQUEST_DEADLINE) {
+		isRequestActive_ = true;
+	}
+	if (timeouts_[type] == 0) {
+		return;
+	}
+	if (type == IDLE_DEADLINE) {
+		lastActivityTime_ = ::GetTickCount64();
+	}
+	addDeadline(type, generation, timeouts_[type]);
+}
+
+void Connection::cancelDeadline(DeadlineType type) {
+	RAPID_ENSURE(type < MAX_DEADLINE_TYPE);
+	// An expiry already taken out of the wheel sees the new generation and is ignored.
+	++deadlineGenerations_[type];
+	removeDeadline(type);
+	if (type == REQUEST_DEADLINE) {
+		isRequestActive_ = false;
+	}
+}
+
+void Connection::resetDeadlines() {
+	for (auto &generation : deadlineGenerations_) {
+		++generation;
+	}
+	for (uint32_t type = 0; type < MAX_DEADLINE_TYPE; ++type) {
+		removeDeadline(static_cast<DeadlineType>(type));
+	}
+	isRecvPending_ = false;
+	isAborting_ = false;
+	isRequestActive_ = false;
+}
+
+void Connection::updateLastActivity() noexcept {
+	if (timeouts_[IDLE_DEADLINE] > 0) {
+		lastActivityTime_ = ::GetTickCount64();
+	}
+}
+
+void Connection::addDeadline(DeadlineType type, uint32_t generation, uint32_t timeout) {
+	pDispatcher_->getDeadlineWheel().add(deadlineSlots_[type], this, type, generation, timeout);
+}
+
+void Connection::removeDeadline(DeadlineType type) {
+	pDispatcher_->getDeadlineWheel().remove(deadlineSlots_[type]);
+}
+
+void Connection::expireDeadline(ConnectionPtr pConn, uint32_t type, uint32_t generation) {
+	auto &strand = pConn->strand_;
+	// Queued behind a completion the reference rides along, it is released after the completion batch
+	// of the thread that runs it rather than inside the strand.
+	strand.dispatch([pConn, type, generation]() mutable {
+		try {
+			pConn->onDeadlineExpired(type, generation);
+		} catch (Exception const &e) {
+			RAPID_LOG_WARN() << "Exception: " << std::dec << e.error() << ", " << e.what();
+		} catch (std::exception const &e) {
+			RAPID_LOG_WARN() << e.what();
+		}
+		details::IoEventDispatcher::releaseAfterBatch(std::move(pConn));
+	});
+}
+
+void Connection::onDeadlineExpired(uint32_t type, uint32_t generation) {
+	if (generation != deadlineGenerations_[type] || isAborting_) {
+		return;
+	}
+
+	if (type == IDLE_DEADLINE) {
+		// The idle deadline is not moved on every IO, check the last activity when it expires instead.
+		auto const idleTime = ::GetTickCount64() - lastActivityTime_;
+		if (idleTime < timeouts_[IDLE_DEADLINE]) {
+			addDeadline(IDLE_DEADLINE, generation, static_cast<uint32_t>(timeouts_[IDLE_DEADLINE] - idleTime));
+			return;
+		}
+	}
+
+	RAPID_LOG_INFO() << "Connection " << getRemoteSocketAddress().toString()
+		<< " deadline " << type << " expired (" << timeouts_[type] << "ms)";
+	abortAndClose();
+}
+
+void Connection::abortAndClose() {
+	isAborting_ = true;
+	halfClosedState_ = ACTIVE_CLOSE;
+
+	if (!isRecvPending_ && !isSendPending_) {
+		disconnect();
+		return;
+	}
+
+	// Disconnect once the cancelled requests have completed, see onAborted.
+	if (isRecvPending_) {
+		::CancelIoEx(acceptSocket_.handle(), pReceiveBuffer_.get());
+	}
+	if (isSendPending_) {
+		::CancelIoEx(acceptSocket_.handle(), pSendBuffer_.get());
+	}
+}
+
+void Connection::drain(std::function<void(ConnectionHandle&)> drainedHandler) {
+	// Posted to the strand of the connection, the drain state is never touched beside a completion.
+	postAsync([drainedHandler](ConnectionHandle pThis) {
+		// A drain also closes a socket accepted while it retires.
+		pThis->isRetiring_ = false;
+		pThis->keptHandler_ = nullptr;
+		pThis->drainedHandler_ = drainedHandler;
+		pThis->startDrain();
+	});
+}
+
+void Connection::retire(std::function<void(ConnectionHandle&)> retiredHandler, std::function<void(ConnectionHandle&)> keptHandler) {
+	postAsync([retiredHandler, keptHandler](ConnectionHandle pThis) {
+		if (!pThis->isAcceptPending() || pThis->isDraining_) {
+			return;
+		}
+		pThis->isRetiring_ = true;
+		pThis->drainedHandler_ = retiredHandler;
+		pThis->keptHandler_ = keptHandler;
+		pThis->startDrain();
+	});
+}
+
+void Connection::shed() {
+	postAsync([](ConnectionHandle pThis) {
+		if (pThis->isAcceptPending()
+			|| pThis->isAborting_
+			|| pThis->lastOptFlags_.flags == details::IOFlags::IO_DISCONNECT_PENDDING
+			|| pThis->lastOptFlags_.flags == details::IOFlags::IO_DISCONNECT_COMPLETED) {
+			return;
+		}
+		RAPID_LOG_WARN() << "Connection " << pThis->getRemoteSocketAddress().toString()
+			<< " shed under memory pressure (" << pThis->getBufferSize() << " bytes)";
+		pThis->abortAndClose();
+	});
+}
+
+void Connection::startDrain() {
+	RAPID_TRACE_CALL();
+
+	isDraining_ = true;
+
+	if (!hasUpdataAcceptContext_) {
+		// AcceptEx still pending, its cancelled completion finishes the drain.
+		::CancelIoEx(pListenSocket_->handle(), this);
+		return;
+	}
+
+	switch (lastOptFlags_.flags) {
+	case details::IOFlags::IO_DISCONNECT_PENDDING:
+		// onDisconnected finishes the drain.
+		break;
+	case details::IOFlags::IO_DISCONNECT_COMPLETED:
+		// Closed and waiting to be reused.
+		onDrained();
+		break;
+	default:
+		if (!isAborting_ && isRecvPending_ && !isRequestActive_ && !hasPendingSend() && pReceiveBuffer_->isEmpty()) {
+			// Waiting for the next request.
+			abortAndClose();
+		}
+		break;
+	}
+}
+
+bool Connection::closeIfDrained() {
+	if (!isDraining_ || isRequestActive_ || hasPendingSend() || !pReceiveBuffer_->isEmpty()) {
+		return false;
+	}
+	RAPID_LOG_TRACE() << "Close drained connection";
+	halfClosedState_ = ACTIVE_CLOSE;
+	acceptSocket_.shutdownSend();
+	disconnect();
+	return true;
+}
+
+void Connection::onDrained() {
+	if (drainedHandler_ == nullptr) {
+		return;
+	}
+	auto handler = std::move(drainedHandler_);
+	drainedHandler_ = nullptr;
+	// The handler may drop the last reference of the pool, keep the connection until its strand is left.
+	details::IoEventDispatcher::releaseAfterBatch(shared_from_this());
+	auto pThis = handle();
+	handler(pThis);
+}
+
+void Connection::onAborted(details::IOFlags opt) {
+	RAPID_TRACE_CALL();
+
+	// The handlers of a timed out connection are not invoked anymore.
+	switch (opt.flags) {
+	case details::IOFlags::IO_RECV_PENDDING:
+		isRecvPending_ = false;
+		break;
+	case details::IOFlags::IO_SEND_PENDDING:
+	case details::IOFlags::IO_SEND_FILE_PENDDING:
+		isSendPending_ = false;
+		break;
+	default:
+		break;
+	}
+
+	if (!isRecvPending_ && !isSendPending_) {
+		disconnect();
+	}
+}
+
+bool Connection::flushSend(IoBuffer *pBuffer) {
+	if (isSendPending_) {
+		// onSend flushes whatever has been queued in the meantime.
+		return false;
+	}
+
+	for (;;) {
+		if (sendFileRemaining_ > 0) {
+			auto const numberOfBytesToWrite = static_cast<uint32_t>(
+				(std::min)(sendFileRemaining_, static_cast<uint64_t>(SEND_FILE_MAX_SIZE)));
+			uint32_t numByteSend = 0;
+			sendBufferBytes_ = pBuffer->readable();
+			sendFileBytes_ = numberOfBytesToWrite;
+			isSendPending_ = true;
+			if (!sendFileAsync(sendFileHandle_, sendFileOffset_, numberOfBytesToWrite, pBuffer, &numByteSend)) {
+				return false;
+			}
+			isSendPending_ = false;
+			retrieveSend(pBuffer, numByteSend);
+			continue;
+		}
+
+		WSABUF iovec[MAX_SEND_IOVEC_COUNT];
+		uint32_t numIovec = 0;
+
+		sendBufferBytes_ = 0;
+		if (!pBuffer->isEmpty()) {
+			iovec[0].buf = pBuffer->peek();
+			iovec[0].len = pBuffer->readable();
+			numIovec = 1;
+			sendBufferBytes_ = iovec[0].len;
+		}
+		numIovec += sendQueue_.gather(iovec + numIovec, MAX_SEND_IOVEC_COUNT - numIovec);
+
+		if (numIovec == 0) {
+			if (isAboveHighWatermark_) {
+				// Drained without a completion, notify from the strand rather than inside the caller's send.
+				postAsync([](ConnectionHandle pThis) {
+					pThis->checkLowWatermark();
+				});
+			}
+			return true;
+		}
+
+		uint32_t numByteSend = 0;
+		isSendPending_ = true;
+		if (!sendAsync(iovec, numIovec, pBuffer, &numByteSend)) {
+			return false;
+		}
+		isSendPending_ = false;
+		retrieveSend(pBuffer, numByteSend);
+	}
+}
+
+void Connection::retrieveSend(IoBuffer *pBuffer, uint32_t size) {
+	updateLastActivity();
+
+	// The send buffer is always the first WSABUF of a gather write and the head of a TransmitFile.
+	// Count against the bytes it had when the write was issued, anything appended since comes after them.
+	auto const bufferBytes = (std::min)(size, sendBufferBytes_);
+	sendBufferBytes_ = 0;
+	if (bufferBytes > 0) {
+		pBuffer->retrieve(bufferBytes);
+	}
+
+	if (pBuffer->ioFlag == details::IOFlags::IO_SEND_FILE_PENDDING
+		|| pBuffer->ioFlag == details::IOFlags::IO_SEND_FILE_COMPLETED) {
+		auto const fileBytes = size - bufferBytes;
+		RAPID_ENSURE(fileBytes <= sendFileRemaining_);
+		sendFileOffset_ += fileBytes;
+		sendFileRemaining_ -= fileBytes;
+		if (fileBytes < sendFileBytes_) {
+			// TransmitFile only completes short at the end of the file, there is nothing more to send.
+			RAPID_LOG_WARN() << "File ended " << sendFileRemaining_ << " bytes before the requested length";
+			sendFileRemaining_ = 0;
+		}
+		sendFileBytes_ = 0;
+		if (sendFileRemaining_ == 0) {
+			sendFileHandle_ = INVALID_HANDLE_VALUE;
+		}
+	} else {
+		sendQueue_.retrieve(size - bufferBytes);
+	}
 }
 
 details::SocketAddress const & Connection::getRemoteSocketAddress() const noexcept {
@@ -238,43 +764,53 @@ void Connection::sendAndDisconnec() {
 	RAPID_TRACE_CALL();
 
 	auto pBuffer = getSendBuffer();
-	if (pBuffer->isEmpty()) {
+	if (!hasPendingSend()) {
 		acceptSocket_.shutdownSend();
 		disconnect();
 	} else {
 		isSendShutdown_ = true;
-		pBuffer->send(shared_from_this());
+		if (pBuffer->send(handle())) {
+			acceptSocket_.shutdownSend();
+			disconnect();
+		}
 	}
 }
 
 void Connection::onSend(IoBuffer *pBuffer, uint32_t bytesTransferred) {
 	RAPID_TRACE_CALL();
 	
-	pBuffer->retrieve(bytesTransferred);
+	isSendPending_ = false;
+	retrieveSend(pBuffer, bytesTransferred);
 
-	if (pBuffer->send(shared_from_this())) {
+	if (pBuffer->send(handle())) {
 		if (isSendShutdown_) {
 			acceptSocket_.shutdownSend();
 			disconnect();
 		} else {
-			auto pThis = shared_from_this();
+			auto pThis = handle();
 			pSendBuffer_->onComplete(pThis);
+			checkLowWatermark();
 		}
+	} else if (!isSendShutdown_) {
+		checkLowWatermark();
 	}
 }
 
 void Connection::onReceive(IoBuffer *pBuffer, uint32_t bytesTransferred) {
 	RAPID_TRACE_CALL();
 
+	isRecvPending_ = false;
+
 	if (bytesTransferred > 0) {
+		updateLastActivity();
 		pBuffer->advanceWriteIndex(bytesTransferred);
-		auto pThis = shared_from_this();
+		auto pThis = handle();
 		pReceiveBuffer_->onComplete(pThis);
 	} else {
 		RAPID_LOG_TRACE() << "Peer shutdwon send";		
 		halfClosedState_ = GRACEFUL_SHUTDOWN;		
 		acceptSocket_.shutdownRecv();
-		if (pSendBuffer_->isEmpty()) {
+		if (!hasPendingSend()) {
 			sendAndDisconnec();
 		}
 	}
@@ -306,6 +842,7 @@ bool Connection::receiveAsync(WSABUF * __restrict iovec, uint32_t numIovec, IoBu
 	DWORD flags = MSG_PARTIAL;
 
 	pBuffer->ioFlag = details::IOFlags::IO_RECV_PENDDING;
+	isRecvPending_ = true;
 
     auto ret = ::WSARecv(acceptSocket_.socketFd(),
                          iovec,
@@ -317,11 +854,14 @@ bool Connection::receiveAsync(WSABUF * __restrict iovec, uint32_t numIovec, IoBu
 
 	if (ret == 0 && *numByteRecv > 0) {
 		pBuffer->ioFlag = details::IOFlags::IO_RECV_COMPLETED;
+		isRecvPending_ = false;
+		updateLastActivity();
         return true;
     }
 
     auto lastError = ::GetLastError();
     if (lastError != ERROR_IO_PENDING) {
+		isRecvPending_ = false;
 		if (lastError == ERROR_SUCCESS) {
 			onReceive(pBuffer, 0);
 		} else {
@@ -413,16 +953,53 @@ uint32_t Connection::getConnectTime() const {
 
 void Connection::onAcceptConnection(uint32_t acceptSize) {
 	updateAcceptContext();
+	// Only the accept completion of this socket writes it, a plain store is enough for the pool controller.
+	acceptCount_.store(acceptCount_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
     
     getAcceptPairAddress(accpetedAddress_);
 
     if (acceptSize > 0) {
         pReceiveBuffer_->advanceWriteIndex(acceptSize);
     }
-	auto pThis = shared_from_this();
+	startDeadline(IDLE_DEADLINE);
+	auto pThis = handle();
 	pAcceptBuffer_->onComplete(pThis);
 }
 
+bool Connection::reclaimBuffers() {
+	// Either the accept completion sees the flag and waits in leavePool, or this sees the socket left the pool.
+	isReclaiming_ = true;
+	auto reclaimingGuard = utils::makeScopeGurad([this]() {
+		isReclaiming_ = false;
+	});
+
+	if (!isPooled_) {
+		return false;
+	}
+	auto const hasReceivePages = pReceiveBuffer_->shrink();
+	auto const hasSendPages = pSendBuffer_->shrink();
+	return hasReceivePages || hasSendPages;
+}
+
+void Connection::leavePool() noexcept {
+	isPooled_ = false;
+	while (isReclaiming_) {
+		_mm_pause();
+	}
+}
+
+void Connection::reuseSocket() {
+	if (isDraining_) {
+		return;
+	}
+	if (pListenSocket_ != nullptr) {
+		acceptAsync();
+	} else if (reuseHandler_ != nullptr) {
+		auto pThis = handle();
+		reuseHandler_(pThis);
+	}
+}
+
 void Connection::addReuseTimingWheel() {
 	auto pConn = shared_from_this();
 
@@ -432,7 +1009,7 @@ void Connection::addReuseTimingWheel() {
 			return;
 		}
 		try {
-			pConn->acceptAsync();
+			pConn->reuseSocket();
 		} catch (Exception const &e) {
 			RAPID_LOG_FATAL() << e.what();
 		}
@@ -441,16 +1018,22 @@ void Connection::addReuseTimingWheel() {
 
 void Connection::onDisconnected() {
 	RAPID_TRACE_CALL();
-	auto pThis = shared_from_this();
+	lastOptFlags_ = details::IOFlags::IO_DISCONNECT_COMPLETED;
+	auto pThis = handle();
 	pDisconnectBuffer_->onComplete(pThis);
 	isReuseSocket_ = true;
+	if (isDraining_) {
+		// The socket is not reused anymore, skip the TIME_WAIT delay.
+		onDrained();
+		return;
+	}
 	if (halfClosedState_ == ACTIVE_CLOSE) {
         // Dsu|TcpsuAiJTIME_WAIT, ҥH[Jaccept pending queue.
 		addReuseTimingWheel();
     } else {
 		RAPID_LOG_TRACE() << "Graceful shutdown finished!";
         // gLTIME-WAITݪ뻼Accept.
-        acceptAsync();
+        reuseSocket();
     }
 }
 
@@ -482,6 +1065,7 @@ void Connection::abortConnection(Exception const &e) {
         }
         break;
 	case WSAECONNABORTED: // 10053
+	case ERROR_NOT_ENOUGH_MEMORY: // A buffer could not grow within the memory budget.
 		disconnect();
 		break;
 	case ERROR_SUCCESS:
@@ -492,22 +1076,65 @@ void Connection::abortConnection(Exception const &e) {
 }
 
 void Connection::onCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred) {
+	if (pBuffer == pPostBuffer_.get()) {
+		// Posted tasks run whatever IO is pending or aborting, lastOptFlags_ must not route them: the next
+		// post queues a completion packet only once they are drained.
+		auto pThis = handle();
+		postTasks_.drain(pThis);
+		return;
+	}
+
 	if (lastOptFlags_ != details::IOFlags::IO_ACCEPT_PENDDING) {
         RAPID_ENSURE(hasUpdataAcceptContext_ == true);
     }
 
+	// Connect and disconnect complete on the connection itself, not on one of its buffers.
 	auto opt = lastOptFlags_;
-	if (opt != details::IOFlags::IO_DISCONNECT_PENDDING && pBuffer != nullptr) {
+	if (opt != details::IOFlags::IO_DISCONNECT_PENDDING
+		&& opt != details::IOFlags::IO_CONNECT_PENDDING
+		&& pBuffer != nullptr) {
 		opt = pBuffer->ioFlag;
 	}
 
+	if (opt == details::IOFlags::IO_ACCEPT_PENDDING) {
+		leavePool();
+	}
+
+	if (isAborting_) {
+		onAborted(opt);
+		return;
+	}
+
     switch (opt.flags) {
     case details::IOFlags::IO_ACCEPT_PENDDING:
+		if (isDraining_ && Internal != 0) {
+			// AcceptEx cancelled by drain.
+			isRetiring_ = false;
+			keptHandler_ = nullptr;
+			hasUpdataAcceptContext_ = true;
+			onDrained();
+			break;
+		}
+		if (isRetiring_) {
+			// The client came in before the cancel, it is served and the socket goes back to the pool.
+			isRetiring_ = false;
+			isDraining_ = false;
+			drainedHandler_ = nullptr;
+			auto handler = std::move(keptHandler_);
+			keptHandler_ = nullptr;
+			if (handler != nullptr) {
+				auto pThis = handle();
+				handler(pThis);
+			}
+		}
 		onAcceptConnection(bytesTransferred);
         break;
     case details::IOFlags::IO_DISCONNECT_PENDDING:
         onDisconnected();
         break;
+	case details::IOFlags::IO_CONNECT_PENDDING:
+		onConnected();
+		break;
     case details::IOFlags::IO_SEND_PENDDING:
         onSend(pBuffer, bytesTransferred);
         break;
@@ -517,11 +1144,6 @@ void Connection::onCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred) {
     case details::IOFlags::IO_SEND_FILE_PENDDING:
 		onSend(pBuffer, bytesTransferred);
         break;
-	case details::IOFlags::IO_POST_PENDDING:{
-			auto pThis = shared_from_this();
-			pPostBuffer_->onComplete(pThis);
-		}
-		break;
     default:
 		// NOTE: Not accept connection, peer abort connection!
         RAPID_ENSURE("Unknown IO operation flag" && 0);
@@ -530,6 +1152,12 @@ void Connection::onCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred) {
 }
 
 void Connection::onIoCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred) {
+	strand_.dispatch([this, pBuffer, bytesTransferred]() {
+		runIoCompletion(pBuffer, bytesTransferred);
+	});
+}
+
+void Connection::runIoCompletion(IoBuffer *pBuffer, uint32_t bytesTransferred) {
     try {
 		onCompletion(pBuffer, bytesTransferred);
     } catch (Exception const &e) {
@@ -11,6 +11,7 @@
 #include <rapid/details/contracts.h>
 #include <rapid/details/numavmemallocator.h>
 #include <rapid/details/vmemallocator.h>
+#include <rapid/details/memorygovernor.h>
 
 #include <rapid/platform/utils.h>
 #include <rapid/platform/privilege.h>
@@ -85,36 +86,42 @@ static DWORD getAllocateBufferSize(bool useLargePages, uint32_t maxPageCount, ui
 	return actualSize;
 }
 
-std::shared_ptr<BlockFactory> BlockFactory::createBlockFactory(uint8_t numNumaNode, uint32_t maxPageCount, uint32_t bufferSize) {
+std::shared_ptr<BlockFactory> BlockFactory::createBlockFactory(uint8_t numNumaNode, uint32_t maxPageCount, uint32_t bufferSize, bool useLargePages) {
 	// tmɭԪOpagejp
 	uint32_t maxPageBoundarySize = 0;
 
 	// O骺jp
 	uint32_t allocPoolSize = 0;
 
-	auto useLargePages = false;
-
 	// ʽ: ϥLarge PageiHCPUiOĶɶ(Pageƶqܤ).
 #ifdef ENABLE_LARGE_PAGES
 	useLargePages = true;
 
-	try {
-		allocPoolSize = getAllocateBufferSize(useLargePages, maxPageCount, bufferSize, maxPageBoundarySize);
-		RAPID_LOG_INFO() << "Enable large-pages success!";
-	}
-	catch (Exception const &e) {
-		allocPoolSize = getAllocateBufferSize(false, maxPageCount, bufferSize, maxPageBoundarySize);
-		RAPID_LOG_ERROR() << "Enable large-pages failure! " << e.what();
-	}
-
 #ifdef ENABLE_LOCK_MEMORY
 	// ʽ: iHwNvirtual memoryw, קKio managerIswvirtual memory.
 	enableLockMemory();
 #endif
 #endif
 
-	allocPoolSize = getAllocateBufferSize(useLargePages, maxPageCount, bufferSize, maxPageBoundarySize);
-    
+	if (useLargePages && ::GetLargePageMinimum() == 0) {
+		RAPID_LOG_ERROR() << "Enable large-pages failure! Not supported by the processor";
+		useLargePages = false;
+	}
+
+	if (useLargePages) {
+		try {
+			allocPoolSize = getAllocateBufferSize(true, maxPageCount, bufferSize, maxPageBoundarySize);
+		}
+		catch (Exception const &e) {
+			RAPID_LOG_ERROR() << "Enable large-pages failure! " << e.what();
+			useLargePages = false;
+		}
+	}
+
+	if (!useLargePages) {
+		allocPoolSize = getAllocateBufferSize(false, maxPageCount, bufferSize, maxPageBoundarySize);
+	}
+
 	MemAllocatorPtr pAllocator;
 
 	if (platform::SystemInfo::getInstance().isNumaSystem()) {
@@ -123,7 +130,9 @@ std::shared_ptr<BlockFactory> BlockFactory::createBlockFactory(uint8_t numNumaNo
 		pAllocator = std::make_shared<details::VMemAllocator>(allocPoolSize, useLargePages);
     }
 	
-	if (useLargePages) {
+	// The allocator falls back to small pages if the system is short of large pages.
+	if (pAllocator->isLargePages()) {
+		RAPID_LOG_INFO() << "Enable large-pages success!";
 		expandWorkingSetSize(pAllocator);
 	}
 
@@ -136,24 +145,165 @@ BlockFactory::BlockFactory(MemAllocatorPtr pAllocator, uint32_t maxPageCount, ui
 	, pageBoundarySize_(maxPageBoundarySize)
 	, pBaseAddress_(pAllocator_->getBaseAddress())
 	, totalPageCount_(maxPageCount)
-	, count_(0) {
+	, count_(0)
+	, expandedSize_(0)
+	, committedSize_(0)
+	, lastExpandTime_(0)
+	, rioBufferId_(RIO_INVALID_BUFFERID)
+	, pfnDeregisterBuffer_(nullptr) {
+	if (pAllocator_->isLargePages()) {
+		committedSize_ = pAllocator_->size();
+		MemoryGovernor::getInstance().charge(MEMORY_IO_BUFFER, committedSize_);
+	}
+}
+
+BlockFactory::~BlockFactory() {
+	if (rioBufferId_ != RIO_INVALID_BUFFERID) {
+		pfnDeregisterBuffer_(rioBufferId_);
+	}
+	MemoryGovernor::getInstance().release(MEMORY_IO_BUFFER, committedSize_);
+}
+
+bool BlockFactory::isPreCommitted() const noexcept {
+	return pAllocator_->isLargePages() || isIoBuffersRegistered();
+}
+
+void BlockFactory::chargeCommit(uint32_t size) {
+	if (isPreCommitted()) {
+		return;
+	}
+	if (!MemoryGovernor::getInstance().tryCharge(MEMORY_IO_BUFFER, size)) {
+		throw Exception(ERROR_NOT_ENOUGH_MEMORY);
+	}
+	committedSize_ += size;
+}
+
+void BlockFactory::releaseCommit(uint32_t size) noexcept {
+	if (isPreCommitted()) {
+		return;
+	}
+	committedSize_ -= size;
+	MemoryGovernor::getInstance().release(MEMORY_IO_BUFFER, size);
 }
 
 Block BlockFactory::getBlock() {
-	RAPID_ENSURE(count_ < totalPageCount_);
+	return getBlock(platform::SystemInfo::getInstance().getPageSize());
+}
+
+Block BlockFactory::getBlock(uint32_t commitSize) {
+	RAPID_ENSURE(commitSize > 0 && commitSize <= pageBoundarySize_);
+	auto const pageSize = platform::SystemInfo::getInstance().roundUpToPageSize(commitSize);
+	chargeCommit(pageSize);
+	auto chargeGuard = utils::makeScopeGurad([this, pageSize]() {
+		releaseCommit(pageSize);
+	});
+
+	uint32_t index = 0;
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		if (!freeBlocks_.empty()) {
+			index = freeBlocks_.back();
+			freeBlocks_.pop_back();
+		} else {
+			// Connections may be created from several IO worker threads, reserve the slot first.
+			index = count_++;
+		}
+	}
+	RAPID_ENSURE(index < totalPageCount_);
+
 	Block block;
     block.allocateSize = pageBoundarySize_;
-	block.pMem = pAllocator_->commit(pBaseAddress_, platform::SystemInfo::getInstance().getPageSize());
-    block.memSize = platform::SystemInfo::getInstance().getPageSize();
-    pBaseAddress_ += pageBoundarySize_;
-	++count_;
+	block.pMem = pAllocator_->commit(pBaseAddress_ + static_cast<size_t>(index) * pageBoundarySize_,
+		pageSize);
+    block.memSize = pageSize;
+	chargeGuard.dismiss();
     return block;
 }
 
+void BlockFactory::releaseBlock(Block const &block) {
+	auto const offset = static_cast<size_t>(block.pMem - pBaseAddress_);
+	RAPID_ENSURE(offset % pageBoundarySize_ == 0 && offset / pageBoundarySize_ < totalPageCount_);
+
+	if (rioBufferId_ == RIO_INVALID_BUFFERID) {
+		pAllocator_->decommit(block.pMem, block.allocateSize);
+	}
+	releaseCommit(block.memSize);
+
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	freeBlocks_.push_back(static_cast<uint32_t>(offset / pageBoundarySize_));
+}
+
+uint32_t BlockFactory::getAvailableBlockCount() const {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	auto const unusedCount = count_ < totalPageCount_ ? totalPageCount_ - count_ : 0;
+	return unusedCount + static_cast<uint32_t>(freeBlocks_.size());
+}
+
+RIO_BUFFERID BlockFactory::registerIoBuffers(RIO_EXTENSION_FUNCTION_TABLE const &rio) {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	if (rioBufferId_ != RIO_INVALID_BUFFERID) {
+		return rioBufferId_;
+	}
+
+	auto const registerSize = static_cast<uint64_t>(totalPageCount_) * pageBoundarySize_;
+	RAPID_ENSURE(registerSize <= pAllocator_->size());
+
+	pAllocator_->commit(pBaseAddress_, static_cast<uint32_t>(registerSize));
+	auto const bufferId = rio.RIORegisterBuffer(pBaseAddress_, static_cast<DWORD>(registerSize));
+	if (bufferId == RIO_INVALID_BUFFERID) {
+		throw Exception(::WSAGetLastError());
+	}
+
+	pfnDeregisterBuffer_ = rio.RIODeregisterBuffer;
+	rioBufferId_ = bufferId;
+
+	// The whole range is committed now, blocks are no longer charged one by one.
+	if (registerSize > committedSize_) {
+		MemoryGovernor::getInstance().charge(MEMORY_IO_BUFFER, registerSize - committedSize_);
+		committedSize_ = registerSize;
+	}
+	return bufferId;
+}
+
+bool BlockFactory::isIoBuffersRegistered() const noexcept {
+	return rioBufferId_ != RIO_INVALID_BUFFERID;
+}
+
+RIO_BUF BlockFactory::getRegisteredBuffer(Block const &block) const noexcept {
+	RIO_BUF buffer;
+	buffer.BufferId = rioBufferId_;
+	buffer.Offset = static_cast<ULONG>(block.pMem - pBaseAddress_);
+	buffer.Length = block.allocateSize;
+	return buffer;
+}
+
+void BlockFactory::addExpandedSize(uint32_t size) {
+	chargeCommit(size);
+	expandedSize_ += size;
+	lastExpandTime_.store(::GetTickCount64(), std::memory_order_relaxed);
+}
+
+void BlockFactory::removeExpandedSize(uint32_t size) noexcept {
+	releaseCommit(size);
+	expandedSize_ -= size;
+}
+
+uint64_t BlockFactory::getExpandedSize() const noexcept {
+	return expandedSize_;
+}
+
+uint64_t BlockFactory::getExpandIdleTime() const noexcept {
+	return ::GetTickCount64() - lastExpandTime_.load(std::memory_order_relaxed);
+}
+
 MemAllocatorPtr BlockFactory::getAllocator() const {
 	return pAllocator_->shared_from_this();
 }
 
+uint64_t BlockFactory::getCommittedSize() const noexcept {
+	return committedSize_;
+}
+
 uint32_t BlockFactory::getSlicePageCount() const noexcept {
     return pageBoundarySize_ / platform::SystemInfo::getInstance().getPageSize();
 }
@@ -12,17 +12,22 @@ namespace rapid {
 
 namespace details {
 
-Buffer::Buffer() {
+Buffer::Buffer()
+	: commitSize_(0) {
 }
 
-Buffer::Buffer(Block const &block, MemAllocatorPtr allocator)
+Buffer::Buffer(Block const &block, std::shared_ptr<BlockFactory> factory)
     : block_(block)
-    , pAllocator_(allocator) {
+    , pAllocator_(factory->getAllocator())
+	, pFactory_(factory) {
 	commitSize_ = block_.memSize;
 }
 
 Buffer::~Buffer() {
-
+	if (pFactory_ != nullptr) {
+		pFactory_->removeExpandedSize(commitSize_ - block_.memSize);
+		pFactory_->releaseBlock(block_);
+	}
 }
 
 char* Buffer::begin() const noexcept {
@@ -37,11 +42,34 @@ void Buffer::expandSize(uint32_t size) {
 	RAPID_ENSURE(size <= block_.allocateSize);
 	if (commitSize_ < size) {
         auto roundPageSize = platform::SystemInfo::getInstance().roundUpToPageSize(size);
-		pAllocator_->commit(block_.pMem + commitSize_, roundPageSize - commitSize_);
+		if (pFactory_ != nullptr) {
+			// Throws if the memory budget is used up, before anything is committed.
+			pFactory_->addExpandedSize(roundPageSize - commitSize_);
+		}
+		try {
+			pAllocator_->commit(block_.pMem + commitSize_, roundPageSize - commitSize_);
+		} catch (...) {
+			if (pFactory_ != nullptr) {
+				pFactory_->removeExpandedSize(roundPageSize - commitSize_);
+			}
+			throw;
+		}
 		commitSize_ = roundPageSize;
     }
 }
 
+bool Buffer::shrink() {
+	if (commitSize_ <= block_.memSize || pAllocator_->isLargePages() || pFactory_->isIoBuffersRegistered()) {
+		return false;
+	}
+	pAllocator_->decommit(block_.pMem + block_.memSize, commitSize_ - block_.memSize);
+	if (pFactory_ != nullptr) {
+		pFactory_->removeExpandedSize(commitSize_ - block_.memSize);
+	}
+	commitSize_ = block_.memSize;
+	return true;
+}
+
 void Buffer::protect() const {
 	pAllocator_->protect(block_.pMem, commitSize_);
 }
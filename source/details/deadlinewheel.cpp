@@ -0,0 +1,150 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include <rapid/platform/platform.h>
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/exception.h>
+#include <rapid/connection.h>
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/ioeventdispatcher.h>
+#include <rapid/details/deadlinewheel.h>
+
+namespace rapid {
+
+namespace details {
+
+DeadlineWheel::DeadlineWheel()
+	: buckets_(MAX_BUCKETS, nullptr)
+	, currentTick_(nowTick())
+	, numDeadlines_(0) {
+}
+
+DeadlineWheel::~DeadlineWheel() {
+	// The dispatcher is going away, release the connections still armed.
+	for (auto &pHead : buckets_) {
+		while (pHead != nullptr) {
+			auto &slot = *pHead;
+			unlink(slot);
+			slot.pOwner.reset();
+		}
+	}
+}
+
+uint64_t DeadlineWheel::nowTick() noexcept {
+	return ::GetTickCount64() / TICK_DURATION;
+}
+
+void DeadlineWheel::link(DeadlineSlot &slot) noexcept {
+	auto &pHead = buckets_[slot.expireTick % buckets_.size()];
+	slot.pPrev = nullptr;
+	slot.pNext = pHead;
+	if (pHead != nullptr) {
+		pHead->pPrev = &slot;
+	}
+	pHead = &slot;
+	slot.linked = true;
+	numDeadlines_.store(numDeadlines_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void DeadlineWheel::unlink(DeadlineSlot &slot) noexcept {
+	if (slot.pPrev != nullptr) {
+		slot.pPrev->pNext = slot.pNext;
+	} else {
+		buckets_[slot.expireTick % buckets_.size()] = slot.pNext;
+	}
+	if (slot.pNext != nullptr) {
+		slot.pNext->pPrev = slot.pPrev;
+	}
+	slot.pPrev = nullptr;
+	slot.pNext = nullptr;
+	slot.linked = false;
+	numDeadlines_.store(numDeadlines_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+}
+
+void DeadlineWheel::add(DeadlineSlot &slot, Connection *pConn, uint32_t type, uint32_t generation, uint32_t timeout) {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+
+	if (slot.linked) {
+		// Re-arming moves the slot, it keeps the reference it holds.
+		unlink(slot);
+	} else {
+		slot.pOwner = pConn->shared_from_this();
+	}
+
+	auto const now = nowTick();
+	if (numDeadlines_.load(std::memory_order_relaxed) == 0) {
+		// Nothing was due while the wheel was empty, skip the idle ticks.
+		currentTick_ = now;
+	}
+
+	// A deadline beyond one round stays in its bucket until the round it expires in.
+	slot.expireTick = (std::max)(now, currentTick_) + (std::max)((timeout + TICK_DURATION - 1) / TICK_DURATION, 1u);
+	slot.type = type;
+	slot.generation = generation;
+	link(slot);
+}
+
+void DeadlineWheel::remove(DeadlineSlot &slot) {
+	std::shared_ptr<Connection> pOwner;
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		if (!slot.linked) {
+			return;
+		}
+		unlink(slot);
+		pOwner = std::move(slot.pOwner);
+	}
+	// Called by the connection itself, its last reference must not go away under it.
+	IoEventDispatcher::releaseAfterBatch(std::move(pOwner));
+}
+
+uint32_t DeadlineWheel::advance(uint32_t maxWaitTime) {
+	if (numDeadlines_.load(std::memory_order_relaxed) == 0) {
+		return maxWaitTime;
+	}
+
+	std::vector<Expired> expired;
+	{
+		auto lock = platform::tryToLock(lock_);
+		if (!lock) {
+			// Another IO thread is expiring them.
+			return (std::min)(maxWaitTime, TICK_DURATION);
+		}
+
+		auto const now = nowTick();
+		auto const numTicks = (std::min)(now - currentTick_, static_cast<uint64_t>(buckets_.size()));
+
+		for (uint64_t i = 1; i <= numTicks; ++i) {
+			auto pSlot = buckets_[(currentTick_ + i) % buckets_.size()];
+			while (pSlot != nullptr) {
+				auto pNext = pSlot->pNext;
+				if (pSlot->expireTick <= now) {
+					unlink(*pSlot);
+					// The generation is taken now, the deadline may be armed again before it is handled.
+					expired.push_back(Expired{ std::move(pSlot->pOwner), pSlot->type, pSlot->generation });
+				}
+				pSlot = pNext;
+			}
+		}
+
+		currentTick_ = now;
+	}
+
+	// Outside the lock, the connection may arm a new deadline while it handles this one.
+	for (auto &deadline : expired) {
+		Connection::expireDeadline(std::move(deadline.pConn), deadline.type, deadline.generation);
+	}
+
+	return numDeadlines_.load(std::memory_order_relaxed) > 0 ? (std::min)(maxWaitTime, TICK_DURATION) : maxWaitTime;
+}
+
+}
+
+}
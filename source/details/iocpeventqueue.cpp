@@ -0,0 +1,44 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <rapid/exception.h>
+#include <rapid/details/iocpeventqueue.h>
+
+namespace rapid {
+
+namespace details {
+
+IocpEventQueue::IocpEventQueue(uint32_t concurrentThreadCount) {
+    handle = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, concurrentThreadCount);
+    if (!handle) {
+        throw Exception();
+    }
+}
+
+IocpEventQueue::~IocpEventQueue() noexcept {
+    if (handle != nullptr) {
+        ::CloseHandle(handle);
+    }
+}
+
+bool IocpEventQueue::associateDevice(HANDLE device, ULONG_PTR compKey) const noexcept {
+    return ::CreateIoCompletionPort(device, handle, compKey, 0) == handle;
+}
+
+bool IocpEventQueue::enqueue(ULONG_PTR compKey, uint32_t numBytes, OVERLAPPED *overlapped) const noexcept {
+    return ::PostQueuedCompletionStatus(handle, numBytes, compKey, overlapped) != FALSE;
+}
+
+bool IocpEventQueue::dequeue(OVERLAPPED_ENTRY * __restrict entries, DWORD N, ULONG * __restrict removeCount, uint32_t timeout) const noexcept {
+    return ::GetQueuedCompletionStatusEx(handle, entries, N, removeCount, timeout, FALSE) != FALSE;
+}
+
+HANDLE IocpEventQueue::getCompletionPort() const noexcept {
+    return handle;
+}
+
+}
+
+}
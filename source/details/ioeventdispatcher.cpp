@@ -3,25 +3,63 @@
 // More license information, please see LICENSE file in module root folder.
 //---------------------------------------------------------------------------------------------------------------------
 
+#include <algorithm>
+
 #include <rapid/exception.h>
 #include <rapid/connection.h>
 #include <rapid/iobuffer.h>
+#include <rapid/ioevent.h>
 
 #include <rapid/logging/logging.h>
 
+#include <rapid/utils/stopwatch.h>
+#include <rapid/utils/scopeguard.h>
+
 #include <rapid/details/contracts.h>
 #include <rapid/details/ioeventqueue.h>
 #include <rapid/details/ioeventdispatcher.h>
+#include <rapid/details/deadlinewheel.h>
 
 namespace rapid {
 
 namespace details {
 
+static thread_local std::vector<std::shared_ptr<void>> *pBatchReleases = nullptr;
+
+class IoTask : public IoEvent {
+public:
+	explicit IoTask(std::function<void()> &&task)
+		: task_(std::move(task)) {
+	}
+
+private:
+	virtual void onCompletion(uint32_t bytesTransferred) override {
+		std::unique_ptr<IoTask> self(this);
+		try {
+			task_();
+		} catch (Exception const &e) {
+			RAPID_LOG_FATAL() << e.error() << " " << e.what();
+		} catch (std::exception const &e) {
+			RAPID_LOG_FATAL() << e.what();
+		}
+	}
+
+	std::function<void()> task_;
+};
+
 IoEventDispatcher::IoEventDispatcher(uint32_t concurrentThreadCount)
-    : pIoEventQueue_(std::make_unique<IoEventQueue>(concurrentThreadCount)) {
+    : pIoEventQueue_(IoEventQueue::createIoEventQueue(concurrentThreadCount))
+	, pDeadlineWheel_(std::make_unique<DeadlineWheel>()) {
+}
+
+IoEventDispatcher::IoEventDispatcher(std::unique_ptr<IoEventQueue> pIoEventQueue)
+	: pIoEventQueue_(std::move(pIoEventQueue))
+	, pDeadlineWheel_(std::make_unique<DeadlineWheel>()) {
+	RAPID_ENSURE(pIoEventQueue_ != nullptr);
 }
 
-IoEventDispatcher::IoEventDispatcher() {
+IoEventDispatcher::IoEventDispatcher()
+	: pDeadlineWheel_(std::make_unique<DeadlineWheel>()) {
 }
 
 IoEventDispatcher::IoEventDispatcher(IoEventDispatcher && other) {
@@ -37,15 +75,48 @@ void IoEventDispatcher::addDevice(HANDLE device, ULONG_PTR compKey) const {
     }
 }
 
+DeadlineWheel & IoEventDispatcher::getDeadlineWheel() const noexcept {
+	return *pDeadlineWheel_;
+}
+
+HANDLE IoEventDispatcher::getCompletionPort() const noexcept {
+	return pIoEventQueue_->getCompletionPort();
+}
+
 void IoEventDispatcher::post(ULONG_PTR compKey, OVERLAPPED *overlapped) const {
 	if (!pIoEventQueue_->enqueue(compKey, -1, overlapped)) {
 		throw Exception();
 	}
 }
 
+void IoEventDispatcher::post(IoEvent *pEvent) const {
+	if (!pIoEventQueue_->enqueue(KEY_IO_EVENT, 0, pEvent)) {
+		throw Exception();
+	}
+}
+
+void IoEventDispatcher::forward(OVERLAPPED_ENTRY const &entry) const {
+	if (!pIoEventQueue_->enqueue(entry.lpCompletionKey, entry.dwNumberOfBytesTransferred, entry.lpOverlapped)) {
+		throw Exception();
+	}
+}
+
+void IoEventDispatcher::postTask(std::function<void()> &&task) const {
+	auto pTask = std::make_unique<IoTask>(std::move(task));
+	post(pTask.get());
+	pTask.release();
+}
+
+void IoEventDispatcher::releaseAfterBatch(std::shared_ptr<void> pObject) {
+	if (pBatchReleases != nullptr) {
+		pBatchReleases->push_back(std::move(pObject));
+	}
+}
+
 IoEventDispatcher & IoEventDispatcher::operator=(IoEventDispatcher && other) {
 	if (this != &other) {
 		pIoEventQueue_ = std::move(other.pIoEventQueue_);
+		pDeadlineWheel_ = std::move(other.pDeadlineWheel_);
 	}
 	return *this;
 }
@@ -56,7 +127,40 @@ void IoEventDispatcher::postQuit() const {
     }
 }
 
-void IoEventDispatcher::waitForIoLoop(uint32_t timeout) const {
+IoWaitCounters::IoWaitCounters() noexcept
+	: spinHits(0)
+	, spinMisses(0)
+	, blockingWakes(0) {
+}
+
+IoWaitStats IoWaitCounters::snapshot() const noexcept {
+	return {
+		spinHits.load(std::memory_order_relaxed),
+		spinMisses.load(std::memory_order_relaxed),
+		blockingWakes.load(std::memory_order_relaxed),
+	};
+}
+
+bool IoEventDispatcher::busyPoll(OVERLAPPED_ENTRY *entries, ULONG *removeCount, uint32_t busyPollTime) const {
+	utils::HighResolutionStopwatch stopwatch;
+	uint32_t numPauses = 1;
+
+	for (;;) {
+		if (pIoEventQueue_->dequeue(entries, MAX_OVERLAPPED_ENTRIES, removeCount, 0)) {
+			return true;
+		}
+		if (stopwatch.elapsedCount<std::chrono::microseconds>() >= busyPollTime) {
+			return false;
+		}
+		// Back off exponentially, an empty queue is polled less often the longer it stays empty.
+		for (uint32_t i = 0; i < numPauses; ++i) {
+			_mm_pause();
+		}
+		numPauses = (std::min)(numPauses * 2, MAX_BUSY_POLL_PAUSES);
+	}
+}
+
+void IoEventDispatcher::waitForIoLoop(uint32_t timeout, uint32_t busyPollTime, IoWaitCounters *pCounters) const {
 	RAPID_TRACE_CALL();
 
 	// NOTE: 
@@ -67,11 +171,36 @@ void IoEventDispatcher::waitForIoLoop(uint32_t timeout) const {
     OVERLAPPED_ENTRY entries[MAX_OVERLAPPED_ENTRIES];
     ULONG removeCount;
 
+	// Deadlines expire on the IO threads, the wait is cut short while any is pending.
+	auto &deadlineWheel = *pDeadlineWheel_;
+	auto waitTimeout = timeout;
+
+	std::vector<std::shared_ptr<void>> batchReleases;
+	pBatchReleases = &batchReleases;
+	auto batchReleasesGuard = utils::makeScopeGurad([]() {
+		pBatchReleases = nullptr;
+	});
+
     for (;;) {
-        auto retval = pIoEventQueue_->dequeue(entries, MAX_OVERLAPPED_ENTRIES, &removeCount, timeout);
+		auto retval = false;
+		if (busyPollTime > 0) {
+			retval = busyPoll(entries, &removeCount, busyPollTime);
+			if (pCounters != nullptr) {
+				IoWaitCounters::increment(retval ? pCounters->spinHits : pCounters->spinMisses);
+			}
+		}
+
+		if (!retval) {
+			retval = pIoEventQueue_->dequeue(entries, MAX_OVERLAPPED_ENTRIES, &removeCount, waitTimeout);
+			if (retval && pCounters != nullptr) {
+				IoWaitCounters::increment(pCounters->blockingWakes);
+			}
+		}
         
 		if (!retval) {
             // NOTICE: This function returns FALSE when no I/O operation was dequeued.
+			waitTimeout = deadlineWheel.advance(timeout);
+			batchReleases.clear();
             continue;
         }
 		
@@ -83,17 +212,29 @@ void IoEventDispatcher::waitForIoLoop(uint32_t timeout) const {
             if (entries[i].lpCompletionKey == 0) {
                 // Accept new connection.
 				pConn = static_cast<Connection*>(entries[i].lpOverlapped);
+				// AcceptEx completes on the listen socket's queue, hand it over to the queue that owns the connection.
+				if (&pConn->getIoEventDispatcher() != this) {
+					pConn->getIoEventDispatcher().forward(entries[i]);
+					continue;
+				}
             } else {
                 if (entries[i].lpCompletionKey == KEY_IO_SERVICE_STOP) {
                     RAPID_LOG_INFO() << "Worker thread stopping...";
                     return;
-                }			
+                }
+				if (entries[i].lpCompletionKey == KEY_IO_EVENT) {
+					static_cast<IoEvent*>(entries[i].lpOverlapped)->onIoCompletion(entries[i].dwNumberOfBytesTransferred);
+					continue;
+				}
 				pConn = reinterpret_cast<Connection*>(entries[i].lpCompletionKey);
 				pBuffer = static_cast<IoBuffer*>(entries[i].lpOverlapped);
             }
 			RAPID_LOG_TRACE() << entries[i].dwNumberOfBytesTransferred << " bytes transferred ";
 			pConn->onIoCompletion(pBuffer, entries[i].dwNumberOfBytesTransferred);
         }
+
+		waitTimeout = deadlineWheel.advance(timeout);
+		batchReleases.clear();
     }
 }
 
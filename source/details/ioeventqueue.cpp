@@ -3,32 +3,17 @@
 // More license information, please see LICENSE file in module root folder.
 //---------------------------------------------------------------------------------------------------------------------
 
-#include <rapid/exception.h>
+#include <rapid/details/iocpeventqueue.h>
 #include <rapid/details/ioeventqueue.h>
 
 namespace rapid {
 
 namespace details {
 
-IoEventQueue::IoEventQueue(uint32_t concurrentThreadCount) {
-    handle = ::CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, concurrentThreadCount);
-    if (!handle) {
-        throw Exception();
-    }
-}
-
-IoEventQueue::~IoEventQueue() noexcept {
-    if (handle != nullptr) {
-        ::CloseHandle(handle);
-    }
-}
-
-bool IoEventQueue::associateDevice(HANDLE device, ULONG_PTR compKey) const noexcept {
-    return ::CreateIoCompletionPort(device, handle, compKey, 0) == handle;
-}
-
-bool IoEventQueue::enqueue(ULONG_PTR compKey, uint32_t numBytes, OVERLAPPED *overlapped) const noexcept {
-    return ::PostQueuedCompletionStatus(handle, numBytes, compKey, overlapped) != FALSE;
+IoEventQueuePtr IoEventQueue::createIoEventQueue(uint32_t concurrentThreadCount) {
+    // Windows only ships the IOCP backend. Another backend has to keep the OVERLAPPED_ENTRY contract
+    // and can be handed to IoEventDispatcher directly.
+    return std::make_unique<IocpEventQueue>(concurrentThreadCount);
 }
 
 }
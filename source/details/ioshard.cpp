@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <sstream>
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/blockfactory.h>
+#include <rapid/details/ioeventdispatcher.h>
+#include <rapid/details/iothreadpool.h>
+#include <rapid/details/ioshard.h>
+
+namespace rapid {
+
+namespace details {
+
+IoShardPtr IoShard::createIoShard(uint32_t index, uint32_t threadCount, std::shared_ptr<BlockFactory> pBlockFactory) {
+	return std::make_shared<IoShard>(index, threadCount, pBlockFactory);
+}
+
+IoShard::IoShard(uint32_t index, uint32_t threadCount, std::shared_ptr<BlockFactory> pBlockFactory)
+	: index_(index)
+	, numThreads_(threadCount)
+	, busyPollTime_(0)
+	, pDispatcher_(std::make_unique<IoEventDispatcher>(threadCount))
+	, pBlockFactory_(pBlockFactory) {
+	RAPID_ENSURE(threadCount > 0);
+	RAPID_ENSURE(pBlockFactory_ != nullptr);
+}
+
+IoShard::~IoShard() {
+	stop();
+}
+
+void IoShard::setBusyPollTime(uint32_t busyPollTime) {
+	RAPID_ENSURE(pThreadPool_ == nullptr);
+	busyPollTime_ = busyPollTime;
+}
+
+void IoShard::setThreadAffinity(std::vector<GROUP_AFFINITY> const &affinities) {
+	RAPID_ENSURE(pThreadPool_ == nullptr);
+	affinities_ = affinities;
+}
+
+void IoShard::start() {
+	std::ostringstream ostr;
+	ostr << "Shard " << index_ << " worker";
+	pThreadPool_ = std::make_unique<IoThreadPool>(numThreads_, *pDispatcher_, ostr.str());
+	pThreadPool_->setBusyPollTime(busyPollTime_);
+	pThreadPool_->setThreadAffinity(affinities_);
+	pThreadPool_->runAll();
+}
+
+void IoShard::stop() {
+	if (pThreadPool_ != nullptr) {
+		pThreadPool_->joinAll();
+	}
+}
+
+std::vector<std::thread> const & IoShard::threads() const {
+	RAPID_ENSURE(pThreadPool_ != nullptr);
+	return pThreadPool_->threads();
+}
+
+std::vector<IoWaitStats> IoShard::getWaitStats() const {
+	RAPID_ENSURE(pThreadPool_ != nullptr);
+	std::vector<IoWaitStats> stats;
+	stats.reserve(numThreads_);
+	for (uint32_t i = 0; i < numThreads_; ++i) {
+		stats.push_back(pThreadPool_->getWaitStats(i));
+	}
+	return stats;
+}
+
+}
+
+}
@@ -17,16 +17,35 @@ namespace rapid {
 namespace details {
 
 IoThreadPool::IoThreadPool(uint32_t threadCount)
+	: IoThreadPool(threadCount, IoEventDispatcher::getInstance(), "Worker") {
+}
+
+IoThreadPool::IoThreadPool(uint32_t threadCount, IoEventDispatcher &dispatcher, std::string const &name)
     : numThreads_(threadCount)
+	, busyPollTime_(0)
+	, pDispatcher_(&dispatcher)
+	, name_(name)
 	, padCacheLineSizeCount_(0)
 	, startedThreadCount_(0) {
     RAPID_ENSURE(threadCount > 0);
+	pWaitCounters_ = std::make_unique<IoWaitCounters[]>(threadCount);
 }
 
 IoThreadPool::~IoThreadPool() {
     joinAll();
 }
 
+void IoThreadPool::setBusyPollTime(uint32_t busyPollTime) {
+	RAPID_ENSURE(pool_.empty());
+	busyPollTime_ = busyPollTime;
+}
+
+void IoThreadPool::setThreadAffinity(std::vector<GROUP_AFFINITY> const &affinities) {
+	RAPID_ENSURE(pool_.empty());
+	RAPID_ENSURE(affinities.empty() || affinities.size() == numThreads_);
+	affinities_ = affinities;
+}
+
 void IoThreadPool::runAll() {
     static auto constexpr WAIT_IO_COMPLETION_TIMEOUT = 15000;
 
@@ -42,9 +61,13 @@ void IoThreadPool::runAll() {
 			_alloca(padCacheLineSizeCount_ * CACHE_LINE_PAD_SIZE);
 
 			try {
-				details::IoEventDispatcher::getInstance().waitForIoLoop(WAIT_IO_COMPLETION_TIMEOUT);
+				if (!affinities_.empty()) {
+					// Pinned before the first completion, so the stack and everything the thread allocates stay on its node.
+					platform::setCurrentThreadAffinity(affinities_[i]);
+				}
+				pDispatcher_->waitForIoLoop(WAIT_IO_COMPLETION_TIMEOUT, busyPollTime_, &pWaitCounters_[i]);
 				// @ThreadɭԳhoe@ӵKey(KEY_IO_SERVICE_STOP), iHקK@ThreadBzhӵKey(KEY_IO_SERVICE_STOP).
-				details::IoEventDispatcher::getInstance().postQuit();
+				pDispatcher_->postQuit();
 			} catch (std::exception const &e) {
 				RAPID_LOG_FATAL() << e.what();
 			} catch (...) {
@@ -53,7 +76,7 @@ void IoThreadPool::runAll() {
         });
 
         std::ostringstream ostr;
-        ostr << "Worker " << i << " thread";
+        ostr << name_ << " " << i << " thread";
         auto const threadName = ostr.str();
         platform::setThreadName(&pool_[i], threadName.c_str());
     }
@@ -74,7 +97,11 @@ void IoThreadPool::ensureStarted() {
 }
 
 void IoThreadPool::joinAll() {
-	details::IoEventDispatcher::getInstance().postQuit();
+	if (pool_.empty()) {
+		return;
+	}
+
+	pDispatcher_->postQuit();
 
     for (auto &thread : pool_) {
         if (thread.joinable())
@@ -88,6 +115,11 @@ std::vector<std::thread> const & IoThreadPool::threads() const {
     return pool_;
 }
 
+IoWaitStats IoThreadPool::getWaitStats(uint32_t threadIndex) const {
+	RAPID_ENSURE(threadIndex < numThreads_);
+	return pWaitCounters_[threadIndex].snapshot();
+}
+
 }
 
 }
@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/memorygovernor.h>
+
+namespace rapid {
+
+namespace details {
+
+MemoryGovernor::MemoryGovernor()
+	: softLimit_(0)
+	, hardLimit_(0)
+	, committedSize_(0)
+	, refusedCount_(0) {
+	for (auto &size : categorySizes_) {
+		size = 0;
+	}
+}
+
+void MemoryGovernor::setLimits(uint64_t softLimit, uint64_t hardLimit) {
+	RAPID_ENSURE(hardLimit == 0 || softLimit <= hardLimit);
+	softLimit_ = softLimit;
+	hardLimit_ = hardLimit;
+}
+
+void MemoryGovernor::charge(MemoryCategory category, uint64_t size) noexcept {
+	committedSize_.fetch_add(size, std::memory_order_relaxed);
+	categorySizes_[category].fetch_add(size, std::memory_order_relaxed);
+}
+
+bool MemoryGovernor::tryCharge(MemoryCategory category, uint64_t size) noexcept {
+	auto const hardLimit = getHardLimit();
+	auto const committedSize = committedSize_.fetch_add(size, std::memory_order_relaxed) + size;
+	if (hardLimit != 0 && committedSize > hardLimit) {
+		// Racing charges may both be refused near the limit, never both admitted beyond it.
+		committedSize_.fetch_sub(size, std::memory_order_relaxed);
+		++refusedCount_;
+		return false;
+	}
+	categorySizes_[category].fetch_add(size, std::memory_order_relaxed);
+	return true;
+}
+
+void MemoryGovernor::release(MemoryCategory category, uint64_t size) noexcept {
+	committedSize_.fetch_sub(size, std::memory_order_relaxed);
+	categorySizes_[category].fetch_sub(size, std::memory_order_relaxed);
+}
+
+MemoryPressure MemoryGovernor::getPressure() const noexcept {
+	auto const committedSize = getCommittedSize();
+	auto const softLimit = getSoftLimit();
+	auto const hardLimit = getHardLimit();
+	if (hardLimit != 0 && committedSize >= hardLimit - (hardLimit - softLimit) / 4) {
+		return MEMORY_PRESSURE_HARD;
+	}
+	if (softLimit != 0 && committedSize >= softLimit) {
+		return MEMORY_PRESSURE_SOFT;
+	}
+	return MEMORY_PRESSURE_NONE;
+}
+
+}
+
+}
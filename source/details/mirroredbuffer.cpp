@@ -0,0 +1,142 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <rapid/exception.h>
+
+#include <rapid/platform/utils.h>
+#include <rapid/platform/dllmap.h>
+
+#include <rapid/details/common.h>
+#include <rapid/details/contracts.h>
+#include <rapid/details/memorygovernor.h>
+#include <rapid/details/mirroredbuffer.h>
+
+// Not in the Windows SDK shipped with VS2015.
+#ifndef MEM_RESERVE_PLACEHOLDER
+#define MEM_RESERVE_PLACEHOLDER 0x00040000
+#endif
+
+#ifndef MEM_REPLACE_PLACEHOLDER
+#define MEM_REPLACE_PLACEHOLDER 0x00004000
+#endif
+
+#ifndef MEM_PRESERVE_PLACEHOLDER
+#define MEM_PRESERVE_PLACEHOLDER 0x00000002
+#endif
+
+namespace rapid {
+
+namespace details {
+
+using VirtualAlloc2API = platform::DLLAPI<PVOID, HANDLE, PVOID, SIZE_T, ULONG, ULONG, PVOID, ULONG>;
+using MapViewOfFile3API = platform::DLLAPI<PVOID, HANDLE, HANDLE, PVOID, ULONG64, SIZE_T, ULONG, ULONG, PVOID, ULONG>;
+
+static VirtualAlloc2API& getVirtualAlloc2() {
+	static VirtualAlloc2API virtualAlloc2("kernelbase.dll", "VirtualAlloc2");
+	return virtualAlloc2;
+}
+
+static MapViewOfFile3API& getMapViewOfFile3() {
+	static MapViewOfFile3API mapViewOfFile3("kernelbase.dll", "MapViewOfFile3");
+	return mapViewOfFile3;
+}
+
+bool MirroredBuffer::isSupported() {
+	static bool const supported = getVirtualAlloc2().valid() && getMapViewOfFile3().valid();
+	return supported;
+}
+
+MirroredBuffer::MirroredBuffer(uint32_t size)
+	: pView_(nullptr)
+	, pMirrorView_(nullptr)
+	, size_(roundUp(size, platform::SystemInfo::getInstance().getPageBoundarySize())) {
+	RAPID_ENSURE(isSupported());
+
+	if (!MemoryGovernor::getInstance().tryCharge(MEMORY_IO_BUFFER, size_)) {
+		throw Exception(ERROR_NOT_ENOUGH_MEMORY);
+	}
+
+	try {
+		auto section = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, size_, nullptr);
+		if (!section) {
+			throw Exception();
+		}
+		// The views keep the section alive.
+		std::unique_ptr<void, decltype(&::CloseHandle)> sectionHandle(section, &::CloseHandle);
+
+		auto placeholder = static_cast<char*>(getVirtualAlloc2()(nullptr,
+			nullptr,
+			2 * static_cast<SIZE_T>(size_),
+			MEM_RESERVE | MEM_RESERVE_PLACEHOLDER,
+			PAGE_NOACCESS,
+			nullptr,
+			0));
+		if (!placeholder) {
+			throw Exception();
+		}
+
+		// Split the placeholder in two, each half is replaced by a view of the same section.
+		if (!::VirtualFree(placeholder, size_, MEM_RELEASE | MEM_PRESERVE_PLACEHOLDER)) {
+			auto const error = ::GetLastError();
+			::VirtualFree(placeholder, 0, MEM_RELEASE);
+			throw Exception(error);
+		}
+
+		pView_ = static_cast<char*>(getMapViewOfFile3()(section,
+			nullptr,
+			placeholder,
+			0,
+			size_,
+			MEM_REPLACE_PLACEHOLDER,
+			PAGE_READWRITE,
+			nullptr,
+			0));
+		if (!pView_) {
+			auto const error = ::GetLastError();
+			::VirtualFree(placeholder, 0, MEM_RELEASE);
+			::VirtualFree(placeholder + size_, 0, MEM_RELEASE);
+			throw Exception(error);
+		}
+
+		pMirrorView_ = static_cast<char*>(getMapViewOfFile3()(section,
+			nullptr,
+			placeholder + size_,
+			0,
+			size_,
+			MEM_REPLACE_PLACEHOLDER,
+			PAGE_READWRITE,
+			nullptr,
+			0));
+		if (!pMirrorView_) {
+			auto const error = ::GetLastError();
+			::VirtualFree(placeholder + size_, 0, MEM_RELEASE);
+			unmap();
+			throw Exception(error);
+		}
+	} catch (...) {
+		MemoryGovernor::getInstance().release(MEMORY_IO_BUFFER, size_);
+		throw;
+	}
+}
+
+MirroredBuffer::~MirroredBuffer() {
+	unmap();
+	MemoryGovernor::getInstance().release(MEMORY_IO_BUFFER, size_);
+}
+
+void MirroredBuffer::unmap() noexcept {
+	if (pMirrorView_ != nullptr) {
+		::UnmapViewOfFile(pMirrorView_);
+		pMirrorView_ = nullptr;
+	}
+	if (pView_ != nullptr) {
+		::UnmapViewOfFile(pView_);
+		pView_ = nullptr;
+	}
+}
+
+}
+
+}
@@ -4,6 +4,7 @@
 //---------------------------------------------------------------------------------------------------------------------
 
 #include <rapid/exception.h>
+#include <rapid/logging/logging.h>
 #include <rapid/details/contracts.h>
 #include <rapid/details/numavmemallocator.h>
 
@@ -15,12 +16,28 @@ NumaVMemAllocator::NumaVMemAllocator(UCHAR node, uint32_t size, bool useLargePag
     : MemAllocator(size, useLargePages)
     , numaNode_(node)
     , currentProcess_(::GetCurrentProcess()) {
-    pBaseAddress_ = reinterpret_cast<char*>(::VirtualAllocExNuma(currentProcess_,
-                                   nullptr,
-                                   memoryAllocateSize_,
-                                   MEM_RESERVE,
-                                   PAGE_READWRITE,
-                                   node));
+	if (useLargePages_) {
+		// Large pages can't be committed into a reserved range, they are committed all at once.
+		pBaseAddress_ = reinterpret_cast<char*>(::VirtualAllocExNuma(currentProcess_,
+			nullptr,
+			memoryAllocateSize_,
+			MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			PAGE_READWRITE,
+			node));
+		if (!pBaseAddress_) {
+			RAPID_LOG_WARN() << "Allocate large pages on node " << static_cast<uint32_t>(node)
+				<< " failure! (" << ::GetLastError() << ") Fall back to small pages";
+			useLargePages_ = false;
+		}
+	}
+	if (!pBaseAddress_) {
+		pBaseAddress_ = reinterpret_cast<char*>(::VirtualAllocExNuma(currentProcess_,
+			nullptr,
+			memoryAllocateSize_,
+			MEM_RESERVE,
+			PAGE_READWRITE,
+			node));
+	}
     if (!pBaseAddress_) {
         throw Exception();
     }
@@ -31,9 +48,12 @@ NumaVMemAllocator::~NumaVMemAllocator() {
 
 char * NumaVMemAllocator::commit(char *addr, uint32_t size) {
     RAPID_ENSURE(addr >= pBaseAddress_ && addr <= pBaseAddress_ + memoryAllocateSize_);
-	DWORD flags = useLargePages_ ? (MEM_COMMIT | MEM_LARGE_PAGES) : (MEM_COMMIT);
+	if (useLargePages_) {
+		// Committed and locked since the allocation.
+		return addr;
+	}
     auto tmp = ::VirtualAllocExNuma(currentProcess_, addr, size,
-		flags, PAGE_READWRITE, numaNode_);
+		MEM_COMMIT, PAGE_READWRITE, numaNode_);
     if (!tmp) {
         throw Exception();
     }
@@ -42,6 +62,9 @@ char * NumaVMemAllocator::commit(char *addr, uint32_t size) {
 
 void NumaVMemAllocator::decommit(char *addr, uint32_t size) {
     RAPID_ENSURE(addr >= pBaseAddress_ && addr <= pBaseAddress_ + memoryAllocateSize_);
+	if (useLargePages_) {
+		return;
+	}
     if (!::VirtualFreeEx(currentProcess_, addr, size, MEM_DECOMMIT)) {
         throw Exception();
     }
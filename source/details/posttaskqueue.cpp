@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/exception.h>
+#include <rapid/details/posttaskqueue.h>
+
+namespace rapid {
+
+namespace details {
+
+PostTaskQueue::PostTaskQueue() noexcept
+	: pHead_(nullptr) {
+}
+
+PostTaskQueue::~PostTaskQueue() {
+	release(pHead_.exchange(nullptr));
+}
+
+void PostTaskQueue::release(Node *pNode) noexcept {
+	while (pNode != nullptr) {
+		auto pNext = pNode->pNext;
+		delete pNode;
+		pNode = pNext;
+	}
+}
+
+bool PostTaskQueue::push(Task task) {
+	auto pNode = new Node{ nullptr, std::move(task) };
+	auto pHead = pHead_.load(std::memory_order_relaxed);
+	do {
+		pNode->pNext = pHead;
+	} while (!pHead_.compare_exchange_weak(pHead, pNode, std::memory_order_release, std::memory_order_relaxed));
+	return pHead == nullptr;
+}
+
+size_t PostTaskQueue::drain(ConnectionHandle &pConn) {
+	// The tasks were pushed LIFO, reverse them to run in posting order.
+	Node *pTask = nullptr;
+	for (auto pNode = pHead_.exchange(nullptr, std::memory_order_acquire); pNode != nullptr;) {
+		auto pNext = pNode->pNext;
+		pNode->pNext = pTask;
+		pTask = pNode;
+		pNode = pNext;
+	}
+
+	size_t numTasks = 0;
+	while (pTask != nullptr) {
+		std::unique_ptr<Node> pNode(pTask);
+		pTask = pTask->pNext;
+		++numTasks;
+		try {
+			pNode->task(pConn);
+		} catch (Exception const &e) {
+			RAPID_LOG_WARN() << "Exception: " << std::dec << e.error() << ", " << e.what();
+		} catch (std::exception const &e) {
+			RAPID_LOG_WARN() << e.what();
+		}
+	}
+	return numTasks;
+}
+
+}
+
+}
@@ -0,0 +1,60 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/sendqueue.h>
+
+namespace rapid {
+
+namespace details {
+
+SendQueue::SendQueue()
+	: queuedBytes_(0) {
+}
+
+void SendQueue::push(char const *data, uint32_t length, std::shared_ptr<void const> owner) {
+	if (length == 0) {
+		return;
+	}
+	RAPID_ENSURE(data != nullptr);
+	segments_.emplace_back(data, length, std::move(owner));
+	queuedBytes_ += length;
+}
+
+uint32_t SendQueue::gather(WSABUF *iovec, uint32_t maxIovec) const noexcept {
+	auto const count = (std::min)(static_cast<uint32_t>(segments_.size()), maxIovec);
+	for (uint32_t i = 0; i < count; ++i) {
+		iovec[i].buf = const_cast<char*>(segments_[i].pData);
+		iovec[i].len = segments_[i].length;
+	}
+	return count;
+}
+
+void SendQueue::retrieve(uint32_t size) {
+	RAPID_ENSURE(size <= queuedBytes_);
+	queuedBytes_ -= size;
+
+	while (size > 0) {
+		auto &segment = segments_.front();
+		if (size < segment.length) {
+			segment.pData += size;
+			segment.length -= size;
+			return;
+		}
+		size -= segment.length;
+		segments_.pop_front();
+	}
+}
+
+void SendQueue::clear() noexcept {
+	segments_.clear();
+	queuedBytes_ = 0;
+}
+
+}
+
+}
@@ -26,6 +26,13 @@ Socket::Socket(int family, int type, int protocol) {
     }
 }
 
+Socket::Socket(int family, int type, int protocol, DWORD flags) {
+	sockDesc_ = ::WSASocket(family, type, protocol, nullptr, 0, flags);
+	if (sockDesc_ == INVALID_SOCKET) {
+		throw SocketException("Socket creation failed (WSASocket())");
+	}
+}
+
 Socket::~Socket() {
     if (sockDesc_ < 0) {
         return;
@@ -92,6 +99,10 @@ CommunicatingSocket::CommunicatingSocket(int family, int type, int protocol)
     : Socket(family, type, protocol) {
 }
 
+CommunicatingSocket::CommunicatingSocket(int family, int type, int protocol, DWORD flags)
+	: Socket(family, type, protocol, flags) {
+}
+
 CommunicatingSocket::CommunicatingSocket(SOCKET newConnSD)
     : Socket(newConnSD) {
 }
@@ -139,6 +150,24 @@ TcpSocket::TcpSocket(SOCKET newConnSD)
     : CommunicatingSocket(newConnSD) {
 }
 
+UdpSocket::UdpSocket(std::string const &localAddress, unsigned short localPort)
+	: UdpSocket(localAddress, localPort, false) {
+}
+
+UdpSocket::UdpSocket(std::string const &localAddress, unsigned short localPort, bool useRegisteredIo)
+    : CommunicatingSocket(SocketAddress::isIPv4Address(localAddress) ? AF_INET : AF_INET6,
+		SOCK_DGRAM,
+		IPPROTO_UDP,
+		WSA_FLAG_OVERLAPPED | (useRegisteredIo ? WSA_FLAG_REGISTERED_IO : 0)) {
+    // Don't fail the pending receives with WSAECONNRESET when a sent datagram gets an ICMP port unreachable.
+    BOOL reportConnReset = FALSE;
+    DWORD bytes = 0;
+    if (::WSAIoctl(sockDesc_, SIO_UDP_CONNRESET, &reportConnReset, sizeof(reportConnReset), nullptr, 0, &bytes, nullptr, nullptr) == SOCKET_ERROR) {
+        throw SocketException("Set SIO_UDP_CONNRESET failed (WSAIoctl())");
+    }
+    setLocalAddressAndPort(localAddress, localPort);
+}
+
 TcpServerSocket::TcpServerSocket(unsigned short localPort, int queueLen, int family)
     : Socket(family, SOCK_STREAM, IPPROTO_TCP) {
     setLocalPort(localPort);
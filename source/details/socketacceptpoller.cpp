@@ -11,6 +11,7 @@
 #include <rapid/details/socketaddress.h>
 
 #include <rapid/utils/scopeguard.h>
+#include <rapid/utils/stringutilis.h>
 
 #include <rapid/logging/logging.h>
 
@@ -33,14 +34,32 @@ namespace details {
 static void defaultCreateContextCallback(ConnectionPtr) {
 }
 
-SocketAcceptPooller::SocketAcceptPooller(std::shared_ptr<TcpServerSocket> &listenSocket, std::shared_ptr<BlockFactory> &factory)
+SocketAcceptPooller::ShardPool::ShardPool(IoShardPtr shard)
+	: pShard(shard)
+	, pendingSocketCount(0) {
+}
+
+SocketAcceptPooller::SocketAcceptPooller(std::shared_ptr<TcpServerSocket> &listenSocket, std::vector<IoShardPtr> const &shards)
     : contextCallback_(defaultCreateContextCallback)
     , pListenSocket_(listenSocket)
-    , pBlockFactory_(factory)
     , postMoreAcceptEvent_(nullptr)
     , shutdownEvent_(nullptr)
     , maxPoolSize_(DEFAULT_POOL_SIZE)
-    , scaleSize_(DEFAULT_POOL_SIZE) {
+    , scaleSize_(DEFAULT_POOL_SIZE)
+	, isDraining_(false)
+	, drainedCount_(0)
+	, acceptRate_(0)
+	, lastAcceptCount_(0)
+	, retiredAcceptCount_(0)
+	, retireKeptCount_(0)
+	, lastControlTime_(0)
+	, surplusRounds_(0)
+	, lastPressure_(MEMORY_PRESSURE_NONE) {
+	RAPID_ENSURE(!shards.empty());
+	shardPools_.reserve(shards.size());
+	for (auto const &pShard : shards) {
+		shardPools_.emplace_back(pShard);
+	}
 }
 
 SocketAcceptPooller::~SocketAcceptPooller() {
@@ -59,7 +78,7 @@ void SocketAcceptPooller::setContextEventHandler(ContextEventHandler &&callback)
 	contextCallback_ = std::forward<ContextEventHandler>(callback);
 }
 
-void SocketAcceptPooller::stopPoll() {
+void SocketAcceptPooller::stopPollerThread() {
     if (shutdownEvent_ != nullptr) {
         ::SetEvent(shutdownEvent_);
     }
@@ -77,17 +96,55 @@ void SocketAcceptPooller::stopPoll() {
         ::CloseHandle(postMoreAcceptEvent_);
         postMoreAcceptEvent_ = nullptr;
     }
+}
 
-	pReuseTimingWheel_.reset();
+void SocketAcceptPooller::stopPoll() {
+	stopPollerThread();
 
     RAPID_LOG_INFO() << "Cancel all pending request";
-    for (auto &pConn : connPool_) {
-        pConn->cancelPendingRequest();
-    }
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	for (auto &pool : shardPools_) {
+		pool.pReuseTimingWheel.reset();
+		for (auto &pConn : pool.connPool) {
+			pConn->cancelPendingRequest();
+		}
+	}
     
 	utils::Singleton<WsaExtAPI>::getInstance().cancelAllPendingIoRequest(*pListenSocket_);
 }
 
+void SocketAcceptPooller::startDrain() {
+	RAPID_TRACE_CALL();
+
+	if (isDraining_.exchange(true)) {
+		return;
+	}
+
+	stopPollerThread();
+
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	for (auto &pool : shardPools_) {
+		for (auto &pConn : pool.connPool) {
+			pConn->drain([this](ConnectionHandle &) {
+				++drainedCount_;
+			});
+		}
+	}
+}
+
+size_t SocketAcceptPooller::getPoolSize() const {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	size_t poolSize = 0;
+	for (auto const &pool : shardPools_) {
+		poolSize += pool.connPool.size();
+	}
+	return poolSize;
+}
+
+size_t SocketAcceptPooller::getDrainedCount() const noexcept {
+	return drainedCount_;
+}
+
 void SocketAcceptPooller::startPoll() {
 	RAPID_TRACE_CALL();
 
@@ -118,12 +175,16 @@ void SocketAcceptPooller::startPoll() {
     }
 
 	// إTIME-WAITAtimer(tγ]w)
-	pReuseTimingWheel_ = TimingWheel::createTimingWheel(1000 * platform::TcpIpParameters::getInstance().getTcpTimedWaitDelay(), 60);
-	pReuseTimingWheel_->start();
+	for (auto &pool : shardPools_) {
+		pool.pReuseTimingWheel = TimingWheel::createTimingWheel(1000 * platform::TcpIpParameters::getInstance().getTcpTimedWaitDelay(), 60);
+		pool.pReuseTimingWheel->start();
+	}
 
-	details::IoEventDispatcher::getInstance().addDevice(pListenSocket_->handle(), 0);
+	// AcceptEx completions are reported on the first shard and forwarded to the shard owning the connection.
+	shardPools_.front().pShard->getIoEventDispatcher().addDevice(pListenSocket_->handle(), 0);
 
-    addSocketToPool();
+    addSocketToPool(scaleSize_);
+	lastControlTime_ = ::GetTickCount64();
 
     pollerThread_ = std::thread(std::bind(&SocketAcceptPooller::pollLoop, this));
    
@@ -137,29 +198,112 @@ void SocketAcceptPooller::startPoll() {
 	postMoreAcceptEventGuard.dismiss();
 }
 
-void SocketAcceptPooller::addSocketToPool() {
-    auto prepareSize = maxPoolSize_ - connPool_.size();
-    if (!prepareSize) {
-        RAPID_LOG_INFO() << "Upper limit on socket pool size!";
-        return;
-    }
+void SocketAcceptPooller::setPollerThreadAffinity(GROUP_AFFINITY const &affinity) {
+	RAPID_ENSURE(pollerThread_.joinable());
+	platform::setThreadAffinity(&pollerThread_, affinity);
+}
+
+void SocketAcceptPooller::addSocketToPool(size_t count) {
+	std::vector<size_t> prepareSizes(shardPools_.size());
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		size_t poolSize = 0;
+		for (auto const &pool : shardPools_) {
+			poolSize += pool.connPool.size() + pool.pendingSocketCount;
+		}
+		if (poolSize >= maxPoolSize_) {
+			RAPID_LOG_INFO() << "Upper limit on socket pool size!";
+			return;
+		}
+		auto const prepareSize = (std::min)(count, maxPoolSize_ - poolSize);
+		// Spread new sockets evenly, the first shards take the remainder.
+		for (size_t i = 0; i < shardPools_.size(); ++i) {
+			prepareSizes[i] = prepareSize / shardPools_.size() + (i < prepareSize % shardPools_.size() ? 1 : 0);
+			// Each socket takes a receive and a send block of the shard.
+			auto const numBlocks = shardPools_[i].pShard->getBlockFactory()->getAvailableBlockCount();
+			prepareSizes[i] = (std::min)(prepareSizes[i], static_cast<size_t>(numBlocks / 2));
+			shardPools_[i].pendingSocketCount += prepareSizes[i];
+		}
+	}
+
+	// Creating a socket and posting AcceptEx is the expensive part of accepting, so spread the batches
+	// over the IO worker threads instead of doing it all on the poller thread.
+	for (size_t i = 0; i < shardPools_.size(); ++i) {
+		postSocketBatch(i, prepareSizes[i]);
+	}
+}
+
+void SocketAcceptPooller::postSocketBatch(size_t shardIndex, size_t count) {
+	auto &dispatcher = shardPools_[shardIndex].pShard->getIoEventDispatcher();
+	// A batch may still be queued when the server shuts down, it keeps the pooller alive until it ran.
+	auto pThis = shared_from_this();
+
+	while (count > 0) {
+		auto const batchSize = (std::min)(count, static_cast<size_t>(ACCEPT_BATCH_SIZE));
+		try {
+			dispatcher.postTask([pThis, shardIndex, batchSize]() {
+				pThis->createSocketBatch(shardIndex, batchSize);
+			});
+		} catch (Exception const &e) {
+			RAPID_LOG_WARN() << "Post accept batch failure! " << e.error();
+			createSocketBatch(shardIndex, batchSize);
+		}
+		count -= batchSize;
+	}
+}
+
+void SocketAcceptPooller::createSocketBatch(size_t shardIndex, size_t count) {
+	auto &pool = shardPools_[shardIndex];
+
+	TimingWheelPtr pReuseTimingWheel;
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		// The wheel is gone once stopPoll ran.
+		if (isDraining_ || pool.pReuseTimingWheel == nullptr) {
+			pool.pendingSocketCount -= count;
+			return;
+		}
+		pReuseTimingWheel = pool.pReuseTimingWheel;
+	}
 
     std::vector<ConnectionPtr> connections;
-	connections.reserve(scaleSize_);
-    
-	for (auto i = prepareSize; i < prepareSize + scaleSize_; ++i) {
-		createSocket(connections);
+	connections.reserve(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		createSocket(pool, pReuseTimingWheel, connections);
     }
 
-	connPool_.reserve(connPool_.size() + connections.size());
-	connPool_.insert(connPool_.end(), connections.begin(), connections.end());
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	pool.pendingSocketCount -= count;
+	pool.connPool.reserve(pool.connPool.size() + connections.size());
+	pool.connPool.insert(pool.connPool.end(), connections.begin(), connections.end());
+
+	if (pool.pReuseTimingWheel == nullptr) {
+		// Created while stopPoll ran, it didn't cancel them.
+		for (auto &pConn : connections) {
+			pConn->cancelPendingRequest();
+		}
+		return;
+	}
+
+	if (isDraining_) {
+		// Created while the drain started, the drain didn't see them.
+		for (auto &pConn : connections) {
+			pConn->drain([this](ConnectionHandle &) {
+				++drainedCount_;
+			});
+		}
+	}
 
-	RAPID_LOG_INFO() << "Background post " << connections.size() << " pre-accepted socket ";
+	RAPID_LOG_INFO() << "Background post " << connections.size() << " pre-accepted socket (shard " << shardIndex << ")";
 }
 
-void SocketAcceptPooller::createSocket(std::vector<ConnectionPtr> &newConnList) {
+void SocketAcceptPooller::createSocket(ShardPool &pool, TimingWheelPtr const &reuseTimingWheel, std::vector<ConnectionPtr> &newConnList) {
     try {
-        auto pConn = std::make_shared<Connection>(pListenSocket_.get(), *pBlockFactory_, pReuseTimingWheel_);
+        auto pConn = std::make_shared<Connection>(pool.pShard->getIoEventDispatcher(),
+			pListenSocket_.get(),
+			*pool.pShard->getBlockFactory(),
+			reuseTimingWheel);
 		contextCallback_(pConn);        
 		pConn->acceptAsync();
         newConnList.push_back(pConn);
@@ -172,6 +316,207 @@ void SocketAcceptPooller::createSocket(std::vector<ConnectionPtr> &newConnList)
 	}
 }
 
+void SocketAcceptPooller::adjustPoolSize(bool hasBacklog) {
+	size_t poolSize = 0;
+	size_t outstanding = 0;
+	uint64_t acceptCount = 0;
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		acceptCount = retiredAcceptCount_;
+		for (auto const &pool : shardPools_) {
+			poolSize += pool.connPool.size();
+			outstanding += pool.pendingSocketCount;
+			for (auto const &pConn : pool.connPool) {
+				acceptCount += pConn->getAcceptCount();
+				if (pConn->isAcceptPending()) {
+					++outstanding;
+				}
+			}
+		}
+	}
+
+	auto const pressure = MemoryGovernor::getInstance().getPressure();
+
+	auto const now = ::GetTickCount64();
+	auto const elapsed = now - lastControlTime_;
+	if (elapsed >= POLL_NETWORK_EVENT_TIMEOUT) {
+		auto const acceptRate = (acceptCount - lastAcceptCount_) * 1000.0 / elapsed;
+		acceptRate_ += ACCEPT_RATE_WEIGHT * (acceptRate - acceptRate_);
+		lastAcceptCount_ = acceptCount;
+		lastControlTime_ = now;
+		reclaimBuffers(pressure != MEMORY_PRESSURE_NONE);
+		applyMemoryPolicy(pressure, outstanding);
+	} else if (!hasBacklog) {
+		return;
+	}
+
+	if (pressure == MEMORY_PRESSURE_HARD) {
+		return;
+	}
+
+	auto target = (std::max)(scaleSize_, static_cast<size_t>(acceptRate_ * BURST_WINDOW + 0.5));
+	if (hasBacklog) {
+		// Connections are waiting in the listen backlog, the pool is behind the burst.
+		target = (std::max)(target, outstanding * 2);
+	}
+	target = (std::min)(target, maxPoolSize_);
+
+	if (outstanding < target) {
+		surplusRounds_ = 0;
+		if (poolSize >= maxPoolSize_ || pressure != MEMORY_PRESSURE_NONE) {
+			// New sockets would take blocks beyond the memory budget.
+			return;
+		}
+		RAPID_LOG_INFO() << "Accept rate " << static_cast<uint32_t>(acceptRate_)
+			<< "/s, " << outstanding << " AcceptEx pending, post " << target - outstanding << " more";
+		addSocketToPool(target - outstanding);
+	} else if (outstanding > target * 2 && poolSize > scaleSize_) {
+		if (++surplusRounds_ >= RETIRE_DELAY) {
+			surplusRounds_ = 0;
+			auto const retireCount = (std::min)(outstanding - target, poolSize - scaleSize_);
+			RAPID_LOG_INFO() << "Accept rate " << static_cast<uint32_t>(acceptRate_)
+				<< "/s, " << outstanding << " AcceptEx pending, retire " << retireCount
+				<< " (" << retireKeptCount_ << " kept by a racing accept so far)";
+			retireSockets(retireCount);
+		}
+	} else {
+		surplusRounds_ = 0;
+	}
+}
+
+void SocketAcceptPooller::retireSockets(size_t count) {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	for (size_t i = 0; i < shardPools_.size() && count > 0; ++i) {
+		for (auto &pConn : shardPools_[i].connPool) {
+			if (count == 0) {
+				break;
+			}
+			if (!pConn->isAcceptPending()) {
+				continue;
+			}
+			// The connection stays in the pool until its AcceptEx has been cancelled.
+			pConn->retire([this, i](ConnectionHandle &conn) {
+				removeFromPool(i, conn);
+			}, [this](ConnectionHandle &) {
+				++retireKeptCount_;
+			});
+			--count;
+		}
+	}
+}
+
+void SocketAcceptPooller::removeFromPool(size_t shardIndex, ConnectionHandle pConn) {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	auto &connPool = shardPools_[shardIndex].connPool;
+	auto itr = std::find_if(connPool.begin(), connPool.end(), [pConn](ConnectionPtr const &pPooled) {
+		return pPooled.get() == pConn.get();
+	});
+	if (itr == connPool.end()) {
+		return;
+	}
+	retiredAcceptCount_ += pConn->getAcceptCount();
+	// The buffers of the connection go back to the block factory of the shard.
+	*itr = std::move(connPool.back());
+	connPool.pop_back();
+}
+
+void SocketAcceptPooller::applyMemoryPolicy(MemoryPressure pressure, size_t outstanding) {
+	auto &governor = MemoryGovernor::getInstance();
+
+	if (pressure != lastPressure_) {
+		RAPID_LOG_WARN() << "Memory pressure " << lastPressure_ << " -> " << pressure
+			<< ", committed " << utils::byteFormat(governor.getCommittedSize(), 1)
+			<< " (buffers " << utils::byteFormat(governor.getCommittedSize(MEMORY_IO_BUFFER), 1)
+			<< ", file cache " << utils::byteFormat(governor.getCommittedSize(MEMORY_FILE_CACHE), 1)
+			<< ", arenas " << utils::byteFormat(governor.getCommittedSize(MEMORY_ARENA), 1) << ")";
+		lastPressure_ = pressure;
+	}
+
+	if (pressure != MEMORY_PRESSURE_HARD) {
+		return;
+	}
+
+	// Refuse new connections: without AcceptEx posted they wait in the listen backlog, and are refused
+	// by the stack once it is full. The controller posts them again when the pressure is gone.
+	if (outstanding > 0) {
+		retireSockets(outstanding);
+	}
+
+	shedConnections();
+}
+
+void SocketAcceptPooller::shedConnections() {
+	auto &governor = MemoryGovernor::getInstance();
+	auto const committedSize = governor.getCommittedSize();
+	auto const softLimit = governor.getSoftLimit();
+	if (committedSize <= softLimit) {
+		return;
+	}
+
+	std::vector<std::pair<uint64_t, ConnectionPtr>> consumers;
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		for (auto const &pool : shardPools_) {
+			for (auto const &pConn : pool.connPool) {
+				if (!pConn->isAcceptPending()) {
+					consumers.emplace_back(pConn->getBufferSize(), pConn);
+				}
+			}
+		}
+	}
+
+	auto const shedCount = (std::min)(consumers.size(), static_cast<size_t>(SHED_BATCH));
+	std::partial_sort(consumers.begin(), consumers.begin() + shedCount, consumers.end(),
+		[](std::pair<uint64_t, ConnectionPtr> const &a, std::pair<uint64_t, ConnectionPtr> const &b) {
+		return a.first > b.first;
+	});
+
+	// The first pages of the blocks stay committed while the socket waits in the pool again.
+	auto const minimumSize = 2ULL * platform::SystemInfo::getInstance().getPageSize();
+	uint64_t shedSize = 0;
+	for (size_t i = 0; i < shedCount && committedSize - shedSize > softLimit; ++i) {
+		if (consumers[i].first <= minimumSize) {
+			break;
+		}
+		consumers[i].second->shed();
+		shedSize += consumers[i].first - minimumSize;
+	}
+}
+
+void SocketAcceptPooller::reclaimBuffers(bool isUnderPressure) {
+	for (size_t i = 0; i < shardPools_.size(); ++i) {
+		auto const &pBlockFactory = shardPools_[i].pShard->getBlockFactory();
+		if (pBlockFactory->getExpandedSize() == 0
+			|| (!isUnderPressure && pBlockFactory->getExpandIdleTime() < RECLAIM_DELAY)) {
+			continue;
+		}
+
+		// Decommitting is a system call per buffer, don't hold the lock meanwhile.
+		std::vector<ConnectionPtr> connPool;
+		{
+			std::lock_guard<platform::Spinlock> guard{ lock_ };
+			connPool = shardPools_[i].connPool;
+		}
+
+		auto const expandedSize = pBlockFactory->getExpandedSize();
+		size_t reclaimCount = 0;
+		for (auto const &pConn : connPool) {
+			try {
+				if (pConn->reclaimBuffers()) {
+					++reclaimCount;
+				}
+			} catch (Exception const &e) {
+				RAPID_LOG_WARN() << "Reclaim buffer failure! " << e.error();
+			}
+		}
+
+		if (reclaimCount > 0) {
+			RAPID_LOG_INFO() << "Reclaim " << utils::byteFormat(expandedSize - pBlockFactory->getExpandedSize(), 1)
+				<< " from " << reclaimCount << " pooled socket (shard " << i << ")";
+		}
+	}
+}
+
 bool SocketAcceptPooller::hasAcceptConnection(WSANETWORKEVENTS *events) const {
     auto retval = ::WSAEnumNetworkEvents(pListenSocket_->socketFd(), postMoreAcceptEvent_, events);
 	if (retval < 0) {
@@ -221,11 +566,12 @@ void SocketAcceptPooller::pollNetworkEvent() {
         // Post more pre-accept connection.
         case WAIT_OBJECT_0 + 1:
 			if (hasAcceptConnection(&events)) {
-                addSocketToPool();
+                adjustPoolSize(true);
                 ::WSAResetEvent(waitEvents[1]);
             }
             break;
 		case WAIT_TIMEOUT:
+			adjustPoolSize(false);
 			break;
         default:
             throw Exception();
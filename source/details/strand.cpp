@@ -0,0 +1,90 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <memory>
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/exception.h>
+#include <rapid/details/strand.h>
+
+namespace rapid {
+
+namespace details {
+
+Strand::Strand() noexcept
+	: pState_(nullptr) {
+}
+
+Strand::~Strand() {
+	auto pNode = pState_.exchange(nullptr);
+	while (pNode != nullptr && pNode != busy()) {
+		auto pNext = pNode->pNext;
+		delete pNode;
+		pNode = pNext;
+	}
+}
+
+Strand::Node * Strand::busy() noexcept {
+	static char s_busyTag;
+	return reinterpret_cast<Node*>(&s_busyTag);
+}
+
+bool Strand::tryEnter() noexcept {
+	Node *pIdle = nullptr;
+	return pState_.compare_exchange_strong(pIdle, busy(), std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+bool Strand::enqueue(Task &&task) {
+	auto pNode = std::make_unique<Node>(Node{ nullptr, std::move(task) });
+	auto pState = pState_.load(std::memory_order_relaxed);
+	for (;;) {
+		if (pState == nullptr) {
+			if (pState_.compare_exchange_weak(pState, busy(), std::memory_order_acquire, std::memory_order_relaxed)) {
+				return false;
+			}
+			continue;
+		}
+		pNode->pNext = (pState == busy()) ? nullptr : pState;
+		if (pState_.compare_exchange_weak(pState, pNode.get(), std::memory_order_release, std::memory_order_relaxed)) {
+			pNode.release();
+			return true;
+		}
+	}
+}
+
+void Strand::leave() {
+	for (;;) {
+		auto pState = busy();
+		if (pState_.compare_exchange_strong(pState, nullptr, std::memory_order_release, std::memory_order_relaxed)) {
+			return;
+		}
+
+		// The tasks were pushed LIFO, reverse them to run in arrival order.
+		Node *pTask = nullptr;
+		for (auto pNode = pState_.exchange(busy(), std::memory_order_acquire); pNode != busy() && pNode != nullptr;) {
+			auto pNext = pNode->pNext;
+			pNode->pNext = pTask;
+			pTask = pNode;
+			pNode = pNext;
+		}
+
+		while (pTask != nullptr) {
+			std::unique_ptr<Node> pNode(pTask);
+			pTask = pTask->pNext;
+			try {
+				pNode->task();
+			} catch (Exception const &e) {
+				RAPID_LOG_WARN() << "Exception: " << std::dec << e.error() << ", " << e.what();
+			} catch (std::exception const &e) {
+				RAPID_LOG_WARN() << e.what();
+			}
+		}
+	}
+}
+
+}
+
+}
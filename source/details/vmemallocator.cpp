@@ -18,7 +18,20 @@ namespace details {
 
 VMemAllocator::VMemAllocator(uint32_t size, bool useLargePages)
     : MemAllocator(size, useLargePages) {
-    pBaseAddress_ = reinterpret_cast<char*>(::VirtualAlloc(nullptr, memoryAllocateSize_, MEM_RESERVE, PAGE_READWRITE));
+	if (useLargePages_) {
+		// Large pages can't be committed into a reserved range, they are committed all at once.
+		pBaseAddress_ = reinterpret_cast<char*>(::VirtualAlloc(nullptr,
+			memoryAllocateSize_,
+			MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+			PAGE_READWRITE));
+		if (!pBaseAddress_) {
+			RAPID_LOG_WARN() << "Allocate large pages failure! (" << ::GetLastError() << ") Fall back to small pages";
+			useLargePages_ = false;
+		}
+	}
+	if (!pBaseAddress_) {
+		pBaseAddress_ = reinterpret_cast<char*>(::VirtualAlloc(nullptr, memoryAllocateSize_, MEM_RESERVE, PAGE_READWRITE));
+	}
     if (!pBaseAddress_) {
         throw Exception();
     }
@@ -50,22 +63,23 @@ void VMemAllocator::query(char *addr, MEMORY_BASIC_INFORMATION *info) {
 
 char * VMemAllocator::commit(char *addr, uint32_t size) {
     RAPID_ENSURE(addr >= pBaseAddress_ && addr <= pBaseAddress_ + memoryAllocateSize_);
-	DWORD flags = useLargePages_ ? (MEM_COMMIT | MEM_LARGE_PAGES) : (MEM_COMMIT);
+	if (useLargePages_) {
+		// Committed and locked since the allocation.
+		return addr;
+	}
     auto tmp = ::VirtualAlloc(addr,
 		size, 
-		flags,
+		MEM_COMMIT,
 		PAGE_READWRITE);
     RAPID_ENSURE(tmp != nullptr);
-	if (useLargePages_) {
-		if (!::VirtualLock(addr, size)) {
-			throw Exception();
-		}
-	}
     return reinterpret_cast<char *>(tmp);
 }
 
 void VMemAllocator::decommit(char *addr, uint32_t size) {
     RAPID_ENSURE(addr >= pBaseAddress_ && addr <= pBaseAddress_ + memoryAllocateSize_);
+	if (useLargePages_) {
+		return;
+	}
     if (!::VirtualFree(addr, size, MEM_DECOMMIT)) {
         throw Exception();
     }
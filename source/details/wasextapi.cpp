@@ -39,8 +39,29 @@ static bool checkIFSProviders() {
     return true;
 }
 
+static bool getRegisteredIoTable(RIO_EXTENSION_FUNCTION_TABLE *pTable) {
+	static GUID constexpr MULTIPLE_RIO_GUID = WSAID_MULTIPLE_RIO;
+
+	UdpSocket tmp("0.0.0.0", 0, true);
+
+	memset(pTable, 0, sizeof(RIO_EXTENSION_FUNCTION_TABLE));
+	pTable->cbSize = sizeof(RIO_EXTENSION_FUNCTION_TABLE);
+
+	DWORD bytes = 0;
+	return ::WSAIoctl(tmp.socketFd(),
+		SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER,
+		LPVOID(&MULTIPLE_RIO_GUID),
+		sizeof(GUID),
+		pTable,
+		sizeof(RIO_EXTENSION_FUNCTION_TABLE),
+		&bytes,
+		nullptr,
+		nullptr) != SOCKET_ERROR;
+}
+
 WsaExtAPI::WsaExtAPI()
-	: isIfsHandleFlag_(false) {
+	: isIfsHandleFlag_(false)
+	, hasRegisteredIo_(false) {
 
 	isIfsHandleFlag_ = checkIFSProviders();
 
@@ -65,6 +86,18 @@ WsaExtAPI::WsaExtAPI()
     } else {
         throw Exception();
     }
+
+	try {
+		hasRegisteredIo_ = details::getRegisteredIoTable(&rioTable_);
+	} catch (Exception const &) {
+		hasRegisteredIo_ = false;
+	}
+
+	RAPID_LOG_IF(rapid::logging::Info, !hasRegisteredIo_) << "Registered I/O is not supported";
+}
+
+RIO_EXTENSION_FUNCTION_TABLE const * WsaExtAPI::getRegisteredIoTable() const noexcept {
+	return hasRegisteredIo_ ? &rioTable_ : nullptr;
 }
 
 bool WsaExtAPI::hasIFSHandleInstalled() const noexcept {
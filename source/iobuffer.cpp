@@ -29,7 +29,10 @@ IoBuffer::IoBuffer()
 	: hasCompleted_(true)
 	, writeIndex_(0)
 	, readIndex_(0)
-	, prependable_(0) {
+	, prependable_(0)
+	, pfnHandler_(nullptr)
+	, pHandlerObject_(nullptr)
+	, pChargedSize_(nullptr) {
 }
 
 IoBuffer::IoBuffer(uint32_t prependSize, details::BlockFactory &factory)
@@ -37,7 +40,10 @@ IoBuffer::IoBuffer(uint32_t prependSize, details::BlockFactory &factory)
 	, writeIndex_(prependSize)
 	, readIndex_(prependSize)
 	, prependable_(prependSize)
-	, buffer_(factory.getBlock(), factory.getAllocator()) {
+	, buffer_(factory.getBlock(), factory.shared_from_this())
+	, pfnHandler_(nullptr)
+	, pHandlerObject_(nullptr)
+	, pChargedSize_(nullptr) {
 }
 
 IoBuffer::~IoBuffer() {
@@ -60,7 +66,7 @@ uint32_t IoBuffer::readable() const noexcept {
 }
 
 uint32_t IoBuffer::writeable() const noexcept {
-    return size() - writeIndex_;
+    return writeLimit() - writeIndex_;
 }
 
 uint32_t IoBuffer::getWrittenSize() const noexcept {
@@ -72,21 +78,32 @@ uint32_t IoBuffer::prependableBytes() const noexcept {
 }
 
 char* IoBuffer::begin() {
+	if (pRing_ != nullptr) {
+		return pRing_->begin();
+	}
     return buffer_.begin();
 }
 
 char const * IoBuffer::begin() const {
+	if (pRing_ != nullptr) {
+		return pRing_->begin();
+	}
     return buffer_.begin();
 }
 
 void IoBuffer::advanceWriteIndex(uint32_t size) {
     writeIndex_ += size;
-    RAPID_ENSURE(writeIndex_ <= this->size());
+    RAPID_ENSURE(writeIndex_ <= writeLimit());
 }
 
 void IoBuffer::advanceReadIndex(uint32_t size) {
     readIndex_ += size;
     RAPID_ENSURE(readIndex_ <= writeIndex_);
+	if (pRing_ != nullptr && readIndex_ >= pRing_->size()) {
+		// The same bytes are mapped one ring lower, keep the read index inside the first view.
+		readIndex_ -= pRing_->size();
+		writeIndex_ -= pRing_->size();
+	}
 }
 
 uint32_t IoBuffer::goodSize() noexcept {
@@ -94,11 +111,14 @@ uint32_t IoBuffer::goodSize() noexcept {
 }
 
 uint32_t IoBuffer::size() const noexcept {
+	if (pRing_ != nullptr) {
+		return pRing_->size();
+	}
     return buffer_.size();
 }
 
 char * IoBuffer::writeData() {
-    RAPID_ENSURE(writeIndex_ <= size());
+    RAPID_ENSURE(writeIndex_ <= writeLimit());
     return begin() + writeIndex_;
 }
 
@@ -108,7 +128,7 @@ char * IoBuffer::peek() {
 }
 
 char const * IoBuffer::writeData() const {
-    RAPID_ENSURE(writeIndex_ <= size());
+    RAPID_ENSURE(writeIndex_ <= writeLimit());
     return begin() + writeIndex_;
 }
 
@@ -117,26 +137,26 @@ char const * IoBuffer::peek() const {
     return begin() + readIndex_;
 }
 
-bool IoBuffer::send(std::shared_ptr<Connection> pConn) {
-	if (isEmpty()) {
-		return true;
-	}	
-	uint32_t numByteSend = 0;
-	auto pReadData = peek();
-	auto readableBytes = readable();
-	hasCompleted_ = false;
-	if (pConn->sendAsync(pReadData, readableBytes, this, &numByteSend)) {
-		retrieve(numByteSend);
+bool IoBuffer::send(ConnectionHandle pConn) {
+	if (!pConn->hasPendingSend()) {
 		return true;
 	}
-	return false;
+	hasCompleted_ = false;
+	return pConn->flushSend(this);
 }
 
-bool IoBuffer::readSome(std::shared_ptr<Connection> pConn) {
+bool IoBuffer::readSome(ConnectionHandle pConn) {
 	return readSome(pConn, goodSize());
 }
 
-bool IoBuffer::readSome(std::shared_ptr<Connection> pConn, uint32_t requireSize) {
+bool IoBuffer::readSome(ConnectionHandle pConn, uint32_t requireSize) {
+	if (pConn->pauseReadIfNotWritable()) {
+		// Resumed by the connection once the pending send bytes drop to the low watermark.
+		return false;
+	}
+	if (pConn->closeIfDrained()) {
+		return false;
+	}
     makeWriteableSpace(requireSize);    
 	resetOverlappedValue();    
 	uint32_t numBytesRecv = 0;	
@@ -157,8 +177,17 @@ void IoBuffer::makeWriteableSpace(uint32_t requireSize) {
 }
 
 void IoBuffer::makeWriteSpace(uint32_t requireSize) {
+	if (pRing_ != nullptr) {
+		// The ring never compacts, a reader that falls a whole ring behind gets a larger one.
+		if (writeable() < requireSize) {
+			remapRing(prependable_ + readable() + requireSize);
+		}
+		return;
+	}
     if (writeable() + prependableBytes() < requireSize + prependable_) {
+		auto const oldSize = size();
 		buffer_.expandSize(writeIndex_ + requireSize);
+		updateChargedSize(oldSize);
     } else {
         auto const readableBytes = readable();
         std::copy(begin() + readIndex_,
@@ -231,6 +260,61 @@ void IoBuffer::reset() noexcept {
     readIndex_ = prependable_;
 }
 
+bool IoBuffer::shrink() {
+	RAPID_ENSURE(isEmpty());
+	if (pRing_ != nullptr) {
+		return false;
+	}
+	reset();
+	auto const oldSize = size();
+	auto const isShrunk = buffer_.shrink();
+	updateChargedSize(oldSize);
+	return isShrunk;
+}
+
+void IoBuffer::releaseRingBuffer() noexcept {
+	auto const oldSize = size();
+	pRing_.reset();
+	reset();
+	updateChargedSize(oldSize);
+}
+
+void IoBuffer::chargeSizeTo(std::atomic<uint64_t> &counter) noexcept {
+	pChargedSize_ = &counter;
+	counter.fetch_add(size(), std::memory_order_relaxed);
+}
+
+void IoBuffer::updateChargedSize(uint32_t oldSize) noexcept {
+	if (pChargedSize_ != nullptr) {
+		// Wraps around modulo 2^64 when the buffer got smaller.
+		pChargedSize_->fetch_add(static_cast<uint64_t>(size()) - oldSize, std::memory_order_relaxed);
+	}
+}
+
+bool IoBuffer::setRingBuffer(uint32_t size) {
+	if (!details::MirroredBuffer::isSupported()) {
+		return false;
+	}
+	if (pRing_ == nullptr || pRing_->size() < size) {
+		remapRing((std::max)(size, prependable_ + readable()));
+	}
+	return true;
+}
+
+void IoBuffer::remapRing(uint32_t size) {
+	auto pRing = std::make_unique<details::MirroredBuffer>(size);
+	auto const oldSize = this->size();
+	auto const readableBytes = readable();
+	RAPID_ENSURE(prependable_ + readableBytes <= pRing->size());
+	std::copy(begin() + readIndex_,
+			  begin() + writeIndex_,
+			  stdext::checked_array_iterator<char*>(pRing->begin() + prependable_, readableBytes));
+	pRing_ = std::move(pRing);
+	readIndex_ = prependable_;
+	writeIndex_ = readIndex_ + readableBytes;
+	updateChargedSize(oldSize);
+}
+
 void IoBuffer::resetOverlappedValue() noexcept {
     Internal = 0;
     InternalHigh = 0;
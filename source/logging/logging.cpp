@@ -15,6 +15,7 @@
 #include <concurrent_queue.h>
 
 #include <rapid/platform/filesystemmonitor.h>
+#include <rapid/platform/threadutils.h>
 
 #include <rapid/details/contracts.h>
 
@@ -97,6 +98,8 @@ public:
     }
 
     void stop();
+
+	void setAffinity(uint16_t group, uint64_t processorMask);
 private:
     static auto constexpr MAX_LOGGING_SIZE = 64 * 1024;
 
@@ -143,6 +146,14 @@ void LoggingWorker::stop() {
     }
 }
 
+void LoggingWorker::setAffinity(uint16_t group, uint64_t processorMask) {
+	GROUP_AFFINITY affinity;
+	memset(&affinity, 0, sizeof(affinity));
+	affinity.Group = group;
+	affinity.Mask = static_cast<KAFFINITY>(processorMask);
+	platform::setThreadAffinity(&writterThread_, affinity);
+}
+
 LoggingWorker::~LoggingWorker() {
     stop();
 }
@@ -201,6 +212,8 @@ public:
 
     void stop();
 
+	void setAffinity(uint16_t group, uint64_t processorMask);
+
 private:
     LoggingWorker worker_;
     std::vector<std::shared_ptr<LogAppender>> appenders_;
@@ -219,6 +232,10 @@ void Logger::stop() {
 	}
 }
 
+void Logger::setAffinity(uint16_t group, uint64_t processorMask) {
+	worker_.setAffinity(group, processorMask);
+}
+
 void Logger::append(LogEntry entry) {
 	worker_.add([this, entry]() {
 		for (auto & pAppender : appenders_) {
@@ -300,6 +317,12 @@ void addLogAppender(std::shared_ptr<LogAppender> pAppender) {
     }
 }
 
+void setLoggingThreadAffinity(uint16_t group, uint64_t processorMask) {
+	if (s_vectoredExceptionHandle != nullptr) {
+		Logger::getInstance().setAffinity(group, processorMask);
+	}
+}
+
 void stopLogging() {
 	if (s_vectoredExceptionHandle != nullptr) {
 		Logger::getInstance().stop();
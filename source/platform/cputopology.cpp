@@ -0,0 +1,172 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include <rapid/exception.h>
+
+#include <rapid/details/contracts.h>
+#include <rapid/platform/cputopology.h>
+
+namespace rapid {
+
+namespace platform {
+
+static std::vector<uint8_t> getLogicalProcessorInformation(LOGICAL_PROCESSOR_RELATIONSHIP relationship) {
+	DWORD returnLength = 0;
+	std::vector<uint8_t> buffer;
+
+	if (!::GetLogicalProcessorInformationEx(relationship, nullptr, &returnLength)) {
+		auto lastError = ::GetLastError();
+		if (lastError != ERROR_INSUFFICIENT_BUFFER) {
+			throw Exception(lastError);
+		}
+	}
+
+	buffer.resize(returnLength);
+	auto pInfo = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+	if (!::GetLogicalProcessorInformationEx(relationship, pInfo, &returnLength)) {
+		throw Exception();
+	}
+	return buffer;
+}
+
+template <typename Lambda>
+static void forEachProcessorInformation(std::vector<uint8_t> const &buffer, Lambda &&handler) {
+	for (size_t offset = 0; offset < buffer.size();) {
+		auto pInfo = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const *>(buffer.data() + offset);
+		handler(*pInfo);
+		offset += pInfo->Size;
+	}
+}
+
+static KAFFINITY lowestProcessor(KAFFINITY mask) noexcept {
+	return mask & (~mask + 1);
+}
+
+CpuTopology::CpuTopology()
+	: numNodes_(0) {
+	std::vector<NUMA_NODE_RELATIONSHIP> nodes;
+	forEachProcessorInformation(getLogicalProcessorInformation(RelationNumaNode), [&nodes](SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const &info) {
+		nodes.push_back(info.NumaNode);
+	});
+	numNodes_ = static_cast<uint32_t>(nodes.size());
+
+	forEachProcessorInformation(getLogicalProcessorInformation(RelationProcessorCore), [this, &nodes](SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX const &info) {
+		// A core never spans processor groups.
+		ProcessorCore core;
+		core.node = 0;
+		core.group = info.Processor.GroupMask[0].Group;
+		core.processorMask = info.Processor.GroupMask[0].Mask;
+		for (auto const &node : nodes) {
+			if (node.GroupMask.Group == core.group && (node.GroupMask.Mask & core.processorMask) != 0) {
+				core.node = node.NodeNumber;
+				break;
+			}
+		}
+		cores_.push_back(core);
+	});
+
+	std::stable_sort(cores_.begin(), cores_.end(), [](ProcessorCore const &lhs, ProcessorCore const &rhs) {
+		if (lhs.node != rhs.node) {
+			return lhs.node < rhs.node;
+		}
+		if (lhs.group != rhs.group) {
+			return lhs.group < rhs.group;
+		}
+		return lowestProcessor(lhs.processorMask) < lowestProcessor(rhs.processorMask);
+	});
+}
+
+std::vector<ProcessorCore> CpuTopology::getNodeCores(uint32_t node) const {
+	std::vector<ProcessorCore> nodeCores;
+	for (auto const &core : cores_) {
+		if (core.node == node) {
+			nodeCores.push_back(core);
+		}
+	}
+	return nodeCores;
+}
+
+std::vector<uint32_t> CpuTopology::getNumaNodes() const {
+	std::vector<uint32_t> nodes;
+	for (auto const &core : cores_) {
+		if (nodes.empty() || nodes.back() != core.node) {
+			nodes.push_back(core.node);
+		}
+	}
+	return nodes;
+}
+
+GROUP_AFFINITY CpuTopology::getNodeAffinity(uint32_t node) const {
+	GROUP_AFFINITY affinity;
+	memset(&affinity, 0, sizeof(affinity));
+
+	auto const nodeCores = getNodeCores(node);
+	if (nodeCores.empty()) {
+		throw Exception(ERROR_INVALID_PARAMETER);
+	}
+
+	affinity.Group = nodeCores.front().group;
+	for (auto const &core : nodeCores) {
+		if (core.group == affinity.Group) {
+			affinity.Mask |= core.processorMask;
+		}
+	}
+	return affinity;
+}
+
+ThreadPlacement CpuTopology::placeThreads(uint32_t node, uint32_t numWorkers, uint32_t numHousekeepingCores, bool useSmtSiblings) const {
+	auto const nodeCores = getNodeCores(node);
+	if (nodeCores.empty()) {
+		throw Exception(ERROR_INVALID_PARAMETER);
+	}
+
+	ThreadPlacement placement;
+	memset(&placement.housekeeping, 0, sizeof(placement.housekeeping));
+
+	// Keep at least one core for the workers.
+	numHousekeepingCores = (std::min)(numHousekeepingCores, static_cast<uint32_t>(nodeCores.size() - 1));
+	if (numHousekeepingCores > 0) {
+		placement.housekeeping.Group = nodeCores.front().group;
+		for (uint32_t i = 0; i < numHousekeepingCores; ++i) {
+			if (nodeCores[i].group == placement.housekeeping.Group) {
+				placement.housekeeping.Mask |= nodeCores[i].processorMask;
+			}
+		}
+	}
+
+	// The n-th hardware thread of every worker core comes before the (n+1)-th of any.
+	std::vector<GROUP_AFFINITY> slots;
+	std::vector<KAFFINITY> remaining;
+	for (auto i = numHousekeepingCores; i < nodeCores.size(); ++i) {
+		remaining.push_back(nodeCores[i].processorMask);
+	}
+	for (auto hasMore = true; hasMore && (slots.empty() || useSmtSiblings);) {
+		hasMore = false;
+		for (size_t i = 0; i < remaining.size(); ++i) {
+			if (remaining[i] == 0) {
+				continue;
+			}
+			GROUP_AFFINITY affinity;
+			memset(&affinity, 0, sizeof(affinity));
+			affinity.Group = nodeCores[numHousekeepingCores + i].group;
+			affinity.Mask = lowestProcessor(remaining[i]);
+			remaining[i] &= ~affinity.Mask;
+			slots.push_back(affinity);
+			hasMore = hasMore || remaining[i] != 0;
+		}
+	}
+
+	// More workers than processors share them round-robin.
+	for (uint32_t i = 0; i < numWorkers; ++i) {
+		placement.workers.push_back(slots[i % slots.size()]);
+	}
+	return placement;
+}
+
+}
+
+}
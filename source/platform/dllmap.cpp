@@ -25,6 +25,9 @@ LPVOID DLLMap::getProcAddress(std::string const &dllName, std::string const &fun
         moduleMap_[dllName] = module;
     }
     auto module = moduleMap_[dllName];
+    if (!module) {
+        return nullptr;
+    }
     LPVOID fp = ::GetProcAddress(module, functionName.c_str());
     return fp;
 }
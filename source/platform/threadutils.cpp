@@ -46,6 +46,19 @@ void setThreadName(std::thread* thread, std::string threadName) {
 	setThreadName(threadId, threadName.c_str());
 }
 
+void setThreadAffinity(std::thread* thread, GROUP_AFFINITY const &affinity) {
+	RAPID_ENSURE(thread != nullptr);
+	if (!::SetThreadGroupAffinity(static_cast<HANDLE>(thread->native_handle()), &affinity, nullptr)) {
+		throw Exception();
+	}
+}
+
+void setCurrentThreadAffinity(GROUP_AFFINITY const &affinity) {
+	if (!::SetThreadGroupAffinity(::GetCurrentThread(), &affinity, nullptr)) {
+		throw Exception();
+	}
+}
+
 static int64_t fileTimeTo100nsec(FILETIME const &fileTime) {
 	auto n = fileTime.dwHighDateTime;
 	n <<= 32;
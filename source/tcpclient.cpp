@@ -0,0 +1,159 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <rapid/platform/tcpipparameters.h>
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/blockfactory.h>
+#include <rapid/details/timingwheel.h>
+#include <rapid/details/socketaddress.h>
+
+#include <rapid/exception.h>
+#include <rapid/connection.h>
+#include <rapid/tcpclient.h>
+
+namespace rapid {
+
+TcpClientPtr TcpClient::createTcpClient(details::IoEventDispatcher &dispatcher,
+	std::shared_ptr<details::BlockFactory> pBlockFactory,
+	uint32_t maxSocketCount) {
+	return std::make_shared<TcpClient>(dispatcher, pBlockFactory, maxSocketCount);
+}
+
+TcpClient::TcpClient(details::IoEventDispatcher &dispatcher,
+	std::shared_ptr<details::BlockFactory> pBlockFactory,
+	uint32_t maxSocketCount)
+	: pDispatcher_(&dispatcher)
+	, pBlockFactory_(pBlockFactory)
+	, maxSocketCount_(maxSocketCount)
+	, socketCount_(0)
+	, maxIdlePerUpstream_(DEFAULT_MAX_IDLE_PER_UPSTREAM) {
+	RAPID_ENSURE(pBlockFactory_ != nullptr);
+	pReuseTimingWheel_ = details::TimingWheel::createTimingWheel(1000 * platform::TcpIpParameters::getInstance().getTcpTimedWaitDelay(), 60);
+	pReuseTimingWheel_->start();
+}
+
+TcpClient::~TcpClient() {
+	close();
+}
+
+void TcpClient::setMaxIdlePerUpstream(uint32_t maxIdleCount) {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	maxIdlePerUpstream_ = maxIdleCount;
+}
+
+void TcpClient::close() {
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	idleConnections_.clear();
+	freeSockets_.clear();
+	sockets_.clear();
+}
+
+ConnectionPtr TcpClient::acquireSocket() {
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		if (!freeSockets_.empty()) {
+			auto pConn = freeSockets_.back();
+			freeSockets_.pop_back();
+			return pConn;
+		}
+		if (socketCount_ >= maxSocketCount_) {
+			throw Exception(WSAENOBUFS);
+		}
+		++socketCount_;
+	}
+
+	auto pConn = std::make_shared<Connection>(*pDispatcher_, nullptr, *pBlockFactory_, pReuseTimingWheel_);
+
+	std::weak_ptr<TcpClient> weakClient = shared_from_this();
+	pConn->setReuseEventHandler([weakClient](ConnectionHandle &conn) {
+		if (auto pClient = weakClient.lock()) {
+			pClient->onSocketReuse(conn);
+		}
+	});
+
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	sockets_.push_back(pConn);
+	return pConn;
+}
+
+void TcpClient::onSocketReuse(ConnectionHandle &pConn) {
+	auto pOwner = pConn.share();
+	std::lock_guard<platform::Spinlock> guard{ lock_ };
+	freeSockets_.push_back(std::move(pOwner));
+}
+
+void TcpClient::connect(details::SocketAddress const &remoteAddress, ConnectEventHandler handler) {
+	RAPID_TRACE_CALL();
+
+	auto const upstream = remoteAddress.toString();
+	ConnectionPtr pConn;
+
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		auto itr = idleConnections_.find(upstream);
+		if (itr != idleConnections_.end() && !itr->second.empty()) {
+			pConn = itr->second.back();
+			itr->second.pop_back();
+		}
+	}
+
+	if (pConn != nullptr) {
+		RAPID_LOG_TRACE() << "Reuse keep-alive connection to " << upstream;
+		auto handle = pConn->handle();
+		handler(handle, ERROR_SUCCESS);
+		return;
+	}
+
+	pConn = acquireSocket();
+
+	// A socket that failed to connect is still bound and goes back to the free list.
+	std::weak_ptr<TcpClient> weakClient = shared_from_this();
+	pConn->setConnectEventHandler([weakClient, handler, upstream](ConnectionHandle &conn, uint32_t error) {
+		if (error != ERROR_SUCCESS) {
+			RAPID_LOG_WARN() << "Connect to " << upstream << " failed! (" << error << ")";
+			if (auto pClient = weakClient.lock()) {
+				pClient->onSocketReuse(conn);
+			}
+		}
+		handler(conn, error);
+	});
+
+	auto handle = pConn->handle();
+	auto connected = false;
+	try {
+		connected = pConn->connectAsync(remoteAddress);
+	} catch (Exception const &e) {
+		onSocketReuse(handle);
+		handler(handle, e.error());
+		return;
+	}
+
+	if (connected) {
+		handler(handle, ERROR_SUCCESS);
+	}
+}
+
+void TcpClient::release(ConnectionHandle pConn) {
+	RAPID_TRACE_CALL();
+
+	auto const upstream = pConn->getRemoteSocketAddress().toString();
+
+	{
+		std::lock_guard<platform::Spinlock> guard{ lock_ };
+		auto &idleList = idleConnections_[upstream];
+		if (idleList.size() < maxIdlePerUpstream_) {
+			idleList.push_back(pConn.share());
+			return;
+		}
+	}
+
+	// Too many idle connections to this upstream, the socket comes back through the reuse handler.
+	pConn->sendAndDisconnec();
+}
+
+}
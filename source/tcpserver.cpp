@@ -4,10 +4,12 @@
 //---------------------------------------------------------------------------------------------------------------------
 
 #include <iomanip>
+#include <thread>
 
 #include <rapid/platform/threadutils.h>
 #include <rapid/platform/utils.h>
 #include <rapid/platform/tcpipparameters.h>
+#include <rapid/platform/cputopology.h>
 
 #include <rapid/utils/singleton.h>
 #include <rapid/utils/stringutilis.h>
@@ -17,15 +19,23 @@
 #include <rapid/details/socketacceptpoller.h>
 #include <rapid/details/wasextapi.h>
 #include <rapid/details/ioeventdispatcher.h>
-#include <rapid/details/iothreadpool.h>
+#include <rapid/details/ioshard.h>
 #include <rapid/details/socketaddress.h>
 #include <rapid/details/blockfactory.h>
+#include <rapid/details/memorygovernor.h>
 
 #include <rapid/logging/logging.h>
+#include <rapid/connection.h>
 #include <rapid/tcpserver.h>
 
 namespace rapid {
 
+struct TcpServer::WorkerGroup {
+	uint16_t numaNode;
+	uint32_t threadCount;
+	platform::ThreadPlacement placement;
+};
+
 TcpServer::TcpServer(uint16_t localPort)
     : TcpServer("0.0.0.0", localPort) {
 }
@@ -37,8 +47,19 @@ TcpServer::TcpServer(std::string const &localAddress, uint16_t localPort)
 TcpServer::TcpServer(std::string const &localAddress, uint16_t localPort, uint32_t threadPerCpu)
     : localAddress_(localAddress)
 	, localPort_(localPort)
+	, numNumaNode_(0)
+	, scaleSocketSize_(0)
+	, poolSocketSize_(0)
+	, clientSocketSize_(0)
     , numThreadPerCpu_(threadPerCpu)
-	, numNumaNode_(0) {
+	, numShards_(1)
+	, busyPollTime_(0)
+	, isAllNumaNodes_(false)
+	, isThreadPinned_(false)
+	, useSmtSiblings_(false)
+	, useLargePages_(false)
+	, numHousekeepingCores_(0)
+	, bufferSize_(0) {
 	RAPID_ENSURE(platform::startupWinSocket());
 }
 
@@ -49,7 +70,12 @@ TcpServer::~TcpServer() {
 void TcpServer::startListening(ContextEventHandler &&callback, uint16_t numaNode) {
 	RAPID_TRACE_CALL();
 
-	numNumaNode_ = numaNode;
+	isAllNumaNodes_ = (numaNode == ALL_NUMA_NODES);
+	numNumaNode_ = isAllNumaNodes_ ? 0 : numaNode;
+
+	if (!pListenSocket_) {
+		setSocketPool(100, 100, 4096);
+	}
 
 	auto const sockName = details::SocketAddress::getSockName(pListenSocket_->socketFd());
 
@@ -62,66 +88,198 @@ void TcpServer::startListening(ContextEventHandler &&callback, uint16_t numaNode
 	
 	setProcessAffinity();
 
-	startThreadPool();
-	
-	if (!pSocketAcceptPooller_) {
-		setSocketPool(100, 100, 4096);
-	}
-	
+	auto const groups = planWorkerGroups();
+
+	startThreadPool(groups);
+
+	pSocketAcceptPooller_ = std::make_shared<details::SocketAcceptPooller>(pListenSocket_, shards_);
+	pSocketAcceptPooller_->setPoolSize(poolSocketSize_);
+	pSocketAcceptPooller_->setScaleSize(scaleSocketSize_);
 	pSocketAcceptPooller_->setContextEventHandler(std::forward<ContextEventHandler>(callback));
 	pSocketAcceptPooller_->startPoll();
+
+	auto const &housekeeping = groups.front().placement.housekeeping;
+	if (housekeeping.Mask != 0) {
+		pSocketAcceptPooller_->setPollerThreadAffinity(housekeeping);
+		logging::setLoggingThreadAffinity(housekeeping.Group, housekeeping.Mask);
+	}
 }
 
 void TcpServer::shutdown() {
     RAPID_LOG_INFO() << "Shutting down server...";
 
-    if (pThreadPool_ != nullptr) {
-        pThreadPool_->joinAll();
-    }
+	for (auto &pShard : shards_) {
+		pShard->stop();
+	}
 
     if (pSocketAcceptPooller_ != nullptr) {
 		pSocketAcceptPooller_->stopPoll();
     }
-    pThreadPool_.reset();
 	pSocketAcceptPooller_.reset();
+	for (auto &pClient : clients_) {
+		pClient->close();
+	}
+	clients_.clear();
+	shards_.clear();
     pListenSocket_.reset();
 }
 
-void TcpServer::startThreadPool() {
-	RAPID_TRACE_CALL();
+bool TcpServer::drain(uint32_t timeout) {
+	static auto constexpr DRAIN_POLL_INTERVAL = 100;
+	static auto constexpr DRAIN_LOG_INTERVAL = 1000;
+
+	if (pSocketAcceptPooller_ == nullptr) {
+		return true;
+	}
+
+	RAPID_LOG_INFO() << "Draining server...";
 
-	uint32_t concurrentThreadCount = 0;
+	pSocketAcceptPooller_->startDrain();
 
+	auto const startTime = ::GetTickCount64();
+	auto lastLogTime = startTime;
+
+	for (;;) {
+		auto const progress = getDrainProgress();
+		if (progress.closedConnections >= progress.totalConnections) {
+			RAPID_LOG_INFO() << "Drained " << progress.totalConnections << " connections";
+			return true;
+		}
+
+		auto const now = ::GetTickCount64();
+		if (now - startTime >= timeout) {
+			RAPID_LOG_WARN() << "Drain timeout, "
+				<< progress.totalConnections - progress.closedConnections << " connections still open";
+			return false;
+		}
+
+		if (now - lastLogTime >= DRAIN_LOG_INTERVAL) {
+			RAPID_LOG_INFO() << "Draining " << progress.closedConnections << "/" << progress.totalConnections << " connections";
+			lastLogTime = now;
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(DRAIN_POLL_INTERVAL));
+	}
+}
+
+DrainProgress TcpServer::getDrainProgress() const {
+	DrainProgress progress = { 0, 0 };
+	if (pSocketAcceptPooller_ != nullptr) {
+		progress.totalConnections = pSocketAcceptPooller_->getPoolSize();
+		progress.closedConnections = pSocketAcceptPooller_->getDrainedCount();
+	}
+	return progress;
+}
+
+uint32_t TcpServer::getConcurrentThreadCount(uint16_t numaNode) const {
+	if (isAllNumaNodes_) {
+		auto const numCores = platform::CpuTopology::getInstance().getNodeCores(numaNode).size();
+		return static_cast<uint32_t>(numCores) * numThreadPerCpu_;
+	}
 	if (platform::SystemInfo::getInstance().isNumaSystem()) {
 		auto const processorInfo = platform::SystemInfo::getInstance().getProcessorInformation();
-		concurrentThreadCount = processorInfo.processorCoreCount * numThreadPerCpu_;
+		return processorInfo.processorCoreCount * numThreadPerCpu_;
+	}
+	return platform::SystemInfo::getInstance().getNumberOfProcessors(numThreadPerCpu_);
+}
+
+std::vector<TcpServer::WorkerGroup> TcpServer::planWorkerGroups() const {
+	auto const &topology = platform::CpuTopology::getInstance();
+
+	std::vector<uint16_t> numaNodes;
+	if (isAllNumaNodes_) {
+		for (auto node : topology.getNumaNodes()) {
+			numaNodes.push_back(static_cast<uint16_t>(node));
+		}
+	} else {
+		numaNodes.push_back(numNumaNode_);
 	}
-	else {
-		concurrentThreadCount = platform::SystemInfo::getInstance().getNumberOfProcessors(numThreadPerCpu_);
+
+	std::vector<WorkerGroup> groups;
+	for (auto numaNode : numaNodes) {
+		WorkerGroup group;
+		group.numaNode = numaNode;
+		group.threadCount = getConcurrentThreadCount(numaNode);
+		memset(&group.placement.housekeeping, 0, sizeof(group.placement.housekeeping));
+
+		if (isThreadPinned_) {
+			// The housekeeping threads run on the first node only.
+			group.placement = topology.placeThreads(numaNode,
+				group.threadCount,
+				groups.empty() ? numHousekeepingCores_ : 0,
+				useSmtSiblings_);
+		} else if (isAllNumaNodes_) {
+			// Keep the workers on their node, the scheduler picks the core.
+			group.placement.workers.assign(group.threadCount, topology.getNodeAffinity(numaNode));
+		}
+		groups.push_back(group);
 	}
+	return groups;
+}
+
+void TcpServer::startThreadPool(std::vector<WorkerGroup> const &groups) {
+	RAPID_TRACE_CALL();
 
-	details::IoEventDispatcher dispatcher(concurrentThreadCount);
-	// OsIoEventDispatcher
-	details::IoEventDispatcher::getInstance() = std::move(dispatcher);
-	pThreadPool_ = std::make_shared<details::IoThreadPool>(concurrentThreadCount);
+	// The shards left over by the division go one each to the first groups.
+	auto const numGroups = static_cast<uint32_t>(groups.size());
+	auto const shardsPerGroup = numShards_ / numGroups;
+	auto const extraShards = numShards_ % numGroups;
 
-	pThreadPool_->runAll();
+	std::vector<uint32_t> groupShardCounts;
+	groupShardCounts.reserve(groups.size());
 
-	uint32_t i = 0;
+	uint32_t numShards = 0;
+	for (uint32_t i = 0; i < numGroups; ++i) {
+		auto const wanted = (std::max)(shardsPerGroup + (i < extraShards ? 1 : 0), 1u);
+		groupShardCounts.push_back((std::min)(wanted, groups[i].threadCount));
+		numShards += groupShardCounts.back();
+	}
 
-	for (auto const &thread : pThreadPool_->threads()) {
-		auto pThread = const_cast<std::thread *>(&thread);
-		if (!platform::SystemInfo::getInstance().isNumaSystem()) {
-			RAPID_LOG_INFO() << "IO Worker thread " << i + 1
-				<< "(" << std::setw(5) << thread.get_id() << ")"
-				<< " starting...";
-		}
-		else {
-			RAPID_LOG_INFO() << "IO Worker thread " << i + 1
-				<< "(" << std::setw(5) << thread.get_id() << "Numa: " << numNumaNode_ << ")"
-				<< " starting...";
+	auto const roundPageSize = platform::SystemInfo::getInstance().roundUpToPageSize(bufferSize_);
+	auto const shardSocketSize = (poolSocketSize_ + numShards - 1) / numShards;
+	auto const shardClientSocketSize = (clientSocketSize_ + numShards - 1) / numShards;
+	auto const maxPageCount = (shardSocketSize + shardClientSocketSize) * 2; // Read and write
+
+	uint32_t shardIndex = 0;
+
+	for (uint32_t groupIndex = 0; groupIndex < numGroups; ++groupIndex) {
+		auto const &group = groups[groupIndex];
+		auto const groupShards = groupShardCounts[groupIndex];
+		auto nextWorker = group.placement.workers.begin();
+
+		for (uint32_t groupShardIndex = 0; groupShardIndex < groupShards; ++groupShardIndex, ++shardIndex) {
+			auto const threadCount = group.threadCount / groupShards + (groupShardIndex < group.threadCount % groupShards ? 1 : 0);
+			// Buffers of the shard come from the node its threads run on.
+			auto pBlockFactory = details::BlockFactory::createBlockFactory(group.numaNode, maxPageCount, roundPageSize, useLargePages_);
+			auto pShard = details::IoShard::createIoShard(shardIndex, threadCount, pBlockFactory);
+			pShard->setBusyPollTime(busyPollTime_);
+			if (!group.placement.workers.empty()) {
+				pShard->setThreadAffinity(std::vector<GROUP_AFFINITY>(nextWorker, nextWorker + threadCount));
+				nextWorker += threadCount;
+			}
+			pShard->start();
+			shards_.push_back(pShard);
+
+			if (shardClientSocketSize > 0) {
+				clients_.push_back(TcpClient::createTcpClient(pShard->getIoEventDispatcher(), pBlockFactory, shardClientSocketSize));
+			}
+
+			uint32_t i = 0;
+
+			for (auto const &thread : pShard->threads()) {
+				if (!platform::SystemInfo::getInstance().isNumaSystem()) {
+					RAPID_LOG_INFO() << "IO Worker thread " << i + 1
+						<< "(" << std::setw(5) << thread.get_id() << " Shard: " << shardIndex << ")"
+						<< " starting...";
+				}
+				else {
+					RAPID_LOG_INFO() << "IO Worker thread " << i + 1
+						<< "(" << std::setw(5) << thread.get_id() << " Shard: " << shardIndex << " Numa: " << group.numaNode << ")"
+						<< " starting...";
+				}
+				++i;
+			}
 		}
-		++i;
 	}
 }
 
@@ -136,7 +294,7 @@ void TcpServer::setProcessAffinity() const {
 			throw Exception();
 		}
 	}
-	else {
+	else if (!isAllNumaNodes_) {
 		for (auto const &numaNode : platform::SystemInfo::getInstance().getNumaProcessorInformation()) {
 			if (numNumaNode_ == numaNode.node) {
 				if (!::SetProcessAffinityMask(::GetCurrentProcess(), numaNode.processorMask)) {
@@ -156,17 +314,68 @@ void TcpServer::setSocketPool(uint16_t scaleSocketSize, uint16_t poolSocketSize,
 	auto const roundPageSize = platform::SystemInfo::getInstance().roundUpToPageSize(bufferSize);
     auto const maxPageCount = poolSocketSize * 2; // Read and write
     auto const allocPoolSize = maxPageCount * roundPageSize;
-    
-	auto pBlockFactory = details::BlockFactory::createBlockFactory(numNumaNode_, maxPageCount, roundPageSize);
 
     RAPID_LOG_INFO() << "Pool size=" << utils::byteFormat(allocPoolSize, 1)
                      << "(page=" << allocPoolSize / SYSTEM_PAGE_SIZE
 					 << ", size=" << utils::byteFormat(roundPageSize, 0)
                      << ")";
-    
-	pSocketAcceptPooller_ = std::make_shared<details::SocketAcceptPooller>(pListenSocket_, pBlockFactory);
-	pSocketAcceptPooller_->setPoolSize(poolSocketSize);
-	pSocketAcceptPooller_->setScaleSize(scaleSocketSize);
+
+	scaleSocketSize_ = scaleSocketSize;
+	poolSocketSize_ = poolSocketSize;
+	bufferSize_ = bufferSize;
+}
+
+void TcpServer::setShardCount(uint32_t shardCount) {
+	RAPID_ENSURE(shardCount > 0);
+	RAPID_ENSURE(shards_.empty());
+	numShards_ = shardCount;
+}
+
+void TcpServer::setClientSocketPool(uint16_t clientSocketSize) {
+	RAPID_ENSURE(shards_.empty());
+	clientSocketSize_ = clientSocketSize;
+}
+
+void TcpServer::setThreadPlacement(uint32_t numHousekeepingCores, bool useSmtSiblings) {
+	RAPID_ENSURE(shards_.empty());
+	isThreadPinned_ = true;
+	numHousekeepingCores_ = numHousekeepingCores;
+	useSmtSiblings_ = useSmtSiblings;
+}
+
+void TcpServer::setBusyPollTime(uint32_t busyPollTime) {
+	RAPID_ENSURE(shards_.empty());
+	busyPollTime_ = busyPollTime;
+}
+
+void TcpServer::setLargePages(bool enable) {
+	RAPID_ENSURE(shards_.empty());
+	useLargePages_ = enable;
+}
+
+void TcpServer::setMemoryLimit(uint64_t softLimit, uint64_t hardLimit) {
+	details::MemoryGovernor::getInstance().setLimits(softLimit, hardLimit);
+}
+
+std::vector<details::IoWaitStats> TcpServer::getIoWaitStats() const {
+	std::vector<details::IoWaitStats> stats;
+	for (auto const &pShard : shards_) {
+		auto const shardStats = pShard->getWaitStats();
+		stats.insert(stats.end(), shardStats.begin(), shardStats.end());
+	}
+	return stats;
+}
+
+TcpClientPtr TcpServer::getTcpClient(ConnectionHandle pConn) const {
+	if (clients_.empty()) {
+		return nullptr;
+	}
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (&shards_[i]->getIoEventDispatcher() == &pConn->getIoEventDispatcher()) {
+			return clients_[i];
+		}
+	}
+	return nullptr;
 }
 
 }
@@ -0,0 +1,441 @@
+//---------------------------------------------------------------------------------------------------------------------
+// Copyright (c) 2015-2016 librapid project. All rights reserved.
+// More license information, please see LICENSE file in module root folder.
+//---------------------------------------------------------------------------------------------------------------------
+
+#include <thread>
+
+#include <rapid/platform/utils.h>
+
+#include <rapid/logging/logging.h>
+
+#include <rapid/details/contracts.h>
+#include <rapid/details/socket.h>
+#include <rapid/details/socketaddress.h>
+#include <rapid/details/blockfactory.h>
+#include <rapid/details/ioeventdispatcher.h>
+#include <rapid/details/wasextapi.h>
+
+#include <rapid/exception.h>
+#include <rapid/ioevent.h>
+#include <rapid/udpserver.h>
+
+namespace rapid {
+
+class DatagramReceiver : public IoEvent {
+public:
+	DatagramReceiver(UdpServer *pServer, details::Block block)
+		: pServer_(pServer)
+		, block_(block)
+		, hasDatagram_(false)
+		, flags_(0)
+		, remoteAddrLen_(0) {
+		memset(&remoteAddr_, 0, sizeof(remoteAddr_));
+	}
+
+	// Returns true if a datagram has been received synchronously.
+	bool receiveAsync(SOCKET socket, uint32_t *numByteRecv) {
+		WSABUF wsabuf = { block_.memSize, block_.pMem };
+
+		for (;;) {
+			resetOverlappedValue();
+			flags_ = 0;
+			remoteAddrLen_ = sizeof(remoteAddr_);
+			hasDatagram_ = true;
+
+			auto ret = ::WSARecvFrom(socket,
+				&wsabuf,
+				1,
+				reinterpret_cast<LPDWORD>(numByteRecv),
+				&flags_,
+				reinterpret_cast<sockaddr*>(&remoteAddr_),
+				&remoteAddrLen_,
+				this,
+				nullptr);
+
+			if (ret == 0) {
+				return true;
+			}
+
+			auto lastError = ::WSAGetLastError();
+			if (lastError == WSA_IO_PENDING) {
+				return false;
+			}
+			if (lastError != WSAEMSGSIZE) {
+				throw Exception(lastError);
+			}
+			// Drop the truncated datagram and receive the next one.
+		}
+	}
+
+	bool hasDatagram() const noexcept {
+		return hasDatagram_;
+	}
+
+	char const * data() const noexcept {
+		return block_.pMem;
+	}
+
+	details::SocketAddress remoteAddress() const {
+		return details::SocketAddress(reinterpret_cast<sockaddr const *>(&remoteAddr_), remoteAddrLen_);
+	}
+
+private:
+	virtual void onCompletion(uint32_t bytesTransferred) override {
+		// Internal holds the NTSTATUS of the receive, anything but STATUS_SUCCESS drops the datagram.
+		hasDatagram_ = (Internal == 0);
+		pServer_->receiveLoop(this, bytesTransferred);
+	}
+
+	UdpServer *pServer_;
+	details::Block block_;
+	bool hasDatagram_;
+	DWORD flags_;
+	INT remoteAddrLen_;
+	SOCKADDR_STORAGE remoteAddr_;
+};
+
+// Receives of the Registered I/O mode. The tail of every block takes the remote address of its datagram,
+// so the block pool is the only registered buffer. One thread at a time handles the completion queue,
+// it is armed with RIONotify again once the results have been handled.
+class RegisteredDatagramReceiver : public IoEvent {
+public:
+	RegisteredDatagramReceiver(UdpServer *pServer,
+		RIO_EXTENSION_FUNCTION_TABLE const &rio,
+		details::BlockFactory &factory,
+		uint32_t numOutstanding)
+		: pServer_(pServer)
+		, rio_(rio)
+		, pFactory_(&factory)
+		, completionQueue_(RIO_INVALID_CQ)
+		, requestQueue_(RIO_INVALID_RQ) {
+		for (uint32_t i = 0; i < numOutstanding; ++i) {
+			blocks_.push_back(factory.getBlock());
+		}
+	}
+
+	~RegisteredDatagramReceiver() {
+		if (completionQueue_ != RIO_INVALID_CQ) {
+			rio_.RIOCloseCompletionQueue(completionQueue_);
+		}
+	}
+
+	void start(SOCKET socket, HANDLE completionPort) {
+		RIO_NOTIFICATION_COMPLETION notification;
+		notification.Type = RIO_IOCP_COMPLETION;
+		notification.Iocp.IocpHandle = completionPort;
+		notification.Iocp.CompletionKey = reinterpret_cast<PVOID>(details::IoEventDispatcher::KEY_IO_EVENT);
+		notification.Iocp.Overlapped = static_cast<OVERLAPPED*>(this);
+
+		auto const numOutstanding = static_cast<DWORD>(blocks_.size());
+		completionQueue_ = rio_.RIOCreateCompletionQueue(numOutstanding + 1, &notification);
+		if (completionQueue_ == RIO_INVALID_CQ) {
+			throw Exception(::WSAGetLastError());
+		}
+
+		// Nothing is sent through the request queue, one send is the least it takes.
+		requestQueue_ = rio_.RIOCreateRequestQueue(socket, numOutstanding, 1, 1, 1, completionQueue_, completionQueue_, nullptr);
+		if (requestQueue_ == RIO_INVALID_RQ) {
+			throw Exception(::WSAGetLastError());
+		}
+
+		for (uint32_t i = 0; i < blocks_.size(); ++i) {
+			receive(i);
+		}
+		notify();
+	}
+
+private:
+	static ULONG constexpr MAX_RESULTS = 128;
+	static ULONG constexpr ADDRESS_SIZE = sizeof(SOCKADDR_INET);
+
+	virtual void onCompletion(uint32_t /*bytesTransferred*/) override {
+		RIORESULT results[MAX_RESULTS];
+
+		for (;;) {
+			auto const numResults = rio_.RIODequeueCompletion(completionQueue_, results, MAX_RESULTS);
+			if (numResults == 0) {
+				break;
+			}
+			if (numResults == RIO_CORRUPT_CQ) {
+				RAPID_LOG_ERROR() << "Registered I/O completion queue corrupted!";
+				--pServer_->activeReceivers_;
+				return;
+			}
+
+			for (ULONG i = 0; i < numResults; ++i) {
+				if (!pServer_->isRunning_) {
+					continue;
+				}
+
+				auto const index = static_cast<uint32_t>(results[i].RequestContext);
+				// A datagram larger than the data slice fails with WSAEMSGSIZE and is dropped.
+				if (results[i].Status == 0) {
+					pServer_->onDatagram(remoteAddress(index), blocks_[index].pMem, results[i].BytesTransferred);
+				}
+
+				try {
+					receive(index);
+				} catch (Exception const &e) {
+					RAPID_LOG_WARN() << "Receive datagram failed! (" << e.error() << ")";
+				}
+			}
+		}
+
+		if (!pServer_->isRunning_) {
+			--pServer_->activeReceivers_;
+			return;
+		}
+		notify();
+	}
+
+	void receive(uint32_t index) {
+		auto data = pFactory_->getRegisteredBuffer(blocks_[index]);
+		data.Length -= ADDRESS_SIZE;
+
+		auto address = data;
+		address.Offset += data.Length;
+		address.Length = ADDRESS_SIZE;
+
+		if (!rio_.RIOReceiveEx(requestQueue_,
+			&data,
+			1,
+			nullptr,
+			&address,
+			nullptr,
+			nullptr,
+			0,
+			reinterpret_cast<PVOID>(static_cast<ULONG_PTR>(index)))) {
+			throw Exception(::WSAGetLastError());
+		}
+	}
+
+	void notify() {
+		auto const retval = rio_.RIONotify(completionQueue_);
+		if (retval != ERROR_SUCCESS && retval != WSAEALREADY) {
+			RAPID_LOG_ERROR() << "Arm registered I/O completion queue failed! (" << retval << ")";
+		}
+	}
+
+	details::SocketAddress remoteAddress(uint32_t index) const {
+		auto const &block = blocks_[index];
+		auto const &address = *reinterpret_cast<SOCKADDR_INET const *>(block.pMem + block.allocateSize - ADDRESS_SIZE);
+		auto const length = (address.si_family == AF_INET) ? sizeof(sockaddr_in) : sizeof(sockaddr_in6);
+		return details::SocketAddress(reinterpret_cast<sockaddr const *>(&address), static_cast<socklen_t>(length));
+	}
+
+	UdpServer *pServer_;
+	RIO_EXTENSION_FUNCTION_TABLE const &rio_;
+	details::BlockFactory *pFactory_;
+	RIO_CQ completionQueue_;
+	RIO_RQ requestQueue_;
+	std::vector<details::Block> blocks_;
+};
+
+UdpServer::UdpServer(uint16_t localPort)
+	: UdpServer("0.0.0.0", localPort) {
+}
+
+UdpServer::UdpServer(std::string const &localAddress, uint16_t localPort)
+	: UdpServer(localAddress, localPort, details::IoEventDispatcher::getInstance()) {
+}
+
+UdpServer::UdpServer(std::string const &localAddress, uint16_t localPort, details::IoEventDispatcher &dispatcher)
+	: isRunning_(false)
+	, useRegisteredIo_(false)
+	, activeReceivers_(0)
+	, pDispatcher_(&dispatcher) {
+	RAPID_ENSURE(platform::startupWinSocket());
+	pSocket_ = std::make_unique<details::UdpSocket>(localAddress, localPort);
+}
+
+UdpServer::~UdpServer() {
+	shutdown();
+}
+
+void UdpServer::startListening(DatagramEventHandler &&handler, uint32_t numOutstanding, uint16_t numaNode) {
+	RAPID_TRACE_CALL();
+
+	RAPID_ENSURE(!isRunning_ && numOutstanding > 0);
+
+	handler_ = std::move(handler);
+
+	auto const bufferSize = platform::SystemInfo::getInstance().roundUpToPageSize(MAX_DATAGRAM_SIZE);
+	pBlockFactory_ = details::BlockFactory::createBlockFactory(numaNode, numOutstanding, bufferSize);
+
+	auto const isRegisteredIo = useRegisteredIo_ && startRegisteredIo(numOutstanding);
+
+	if (!isRegisteredIo) {
+		details::WsaExtAPI::getInstance().setSkipIoSyncNotify(*pSocket_);
+		pDispatcher_->addDevice(pSocket_->handle(), details::IoEventDispatcher::KEY_IO_EVENT);
+
+		for (uint32_t i = 0; i < numOutstanding; ++i) {
+			// The whole datagram must fit, a receive into the first page alone drops anything larger.
+			receivers_.push_back(std::make_unique<DatagramReceiver>(this, pBlockFactory_->getBlock(bufferSize)));
+		}
+	}
+
+	auto const sockName = details::SocketAddress::getSockName(pSocket_->socketFd());
+
+	RAPID_LOG_INFO() << "UDP server is listening on "
+		<< sockName.addressToString()
+		<< " port "
+		<< sockName.port()
+		<< " (" << numOutstanding << " outstanding receives"
+		<< (isRegisteredIo ? ", registered I/O)" : ")");
+
+	isRunning_ = true;
+
+	if (isRegisteredIo) {
+		// The completion queue notification stands for all the receives.
+		activeReceivers_ = 1;
+		try {
+			pRegisteredReceiver_->start(pSocket_->socketFd(), pDispatcher_->getCompletionPort());
+		} catch (...) {
+			isRunning_ = false;
+			activeReceivers_ = 0;
+			throw;
+		}
+		return;
+	}
+
+	activeReceivers_ = numOutstanding;
+
+	// Post the first receives from the worker threads, a datagram may already be waiting.
+	for (auto &pReceiver : receivers_) {
+		auto pRawReceiver = pReceiver.get();
+		pDispatcher_->postTask([this, pRawReceiver]() {
+			startReceive(pRawReceiver);
+		});
+	}
+}
+
+void UdpServer::setRegisteredIo(bool enable) {
+	RAPID_ENSURE(!isRunning_);
+	useRegisteredIo_ = enable;
+}
+
+bool UdpServer::startRegisteredIo(uint32_t numOutstanding) {
+	auto const pRio = details::WsaExtAPI::getInstance().getRegisteredIoTable();
+	auto const completionPort = pDispatcher_->getCompletionPort();
+	if (pRio == nullptr || completionPort == nullptr) {
+		RAPID_LOG_WARN() << "Registered I/O is not available, receive with WSARecvFrom";
+		return false;
+	}
+
+	// Registered I/O needs a socket created for it, bind the new one to the address of the plain one.
+	auto const sockName = details::SocketAddress::getSockName(pSocket_->socketFd());
+	pSocket_.reset();
+	pSocket_ = std::make_unique<details::UdpSocket>(sockName.addressToString(), sockName.port(), true);
+
+	pBlockFactory_->registerIoBuffers(*pRio);
+	pRegisteredReceiver_ = std::make_unique<RegisteredDatagramReceiver>(this, *pRio, *pBlockFactory_, numOutstanding);
+	return true;
+}
+
+void UdpServer::onDatagram(details::SocketAddress const &remoteAddress, char const *data, uint32_t length) {
+	try {
+		handler_(*this, remoteAddress, data, length);
+	} catch (Exception const &e) {
+		RAPID_LOG_WARN() << "Exception: " << std::dec << e.error() << ", " << e.what();
+	} catch (std::exception const &e) {
+		RAPID_LOG_WARN() << e.what();
+	}
+}
+
+void UdpServer::startReceive(DatagramReceiver *pReceiver) {
+	uint32_t bytesTransferred = 0;
+	try {
+		if (!isRunning_ || !pReceiver->receiveAsync(pSocket_->socketFd(), &bytesTransferred)) {
+			if (!isRunning_) {
+				--activeReceivers_;
+			}
+			return;
+		}
+	} catch (Exception const &e) {
+		RAPID_LOG_WARN() << "Receive datagram failed! (" << e.error() << ")";
+		--activeReceivers_;
+		return;
+	}
+
+	if (details::WsaExtAPI::getInstance().hasIFSHandleInstalled()) {
+		receiveLoop(pReceiver, bytesTransferred);
+	}
+}
+
+void UdpServer::receiveLoop(DatagramReceiver *pReceiver, uint32_t bytesTransferred) {
+	for (;;) {
+		if (!isRunning_) {
+			--activeReceivers_;
+			return;
+		}
+
+		if (pReceiver->hasDatagram()) {
+			onDatagram(pReceiver->remoteAddress(), pReceiver->data(), bytesTransferred);
+		}
+
+		try {
+			if (!pReceiver->receiveAsync(pSocket_->socketFd(), &bytesTransferred)) {
+				return;
+			}
+		} catch (Exception const &e) {
+			if (isRunning_) {
+				RAPID_LOG_WARN() << "Receive datagram failed! (" << e.error() << ")";
+			}
+			--activeReceivers_;
+			return;
+		}
+
+		// Without FILE_SKIP_COMPLETION_PORT_ON_SUCCESS the completion packet is queued anyway.
+		if (!details::WsaExtAPI::getInstance().hasIFSHandleInstalled()) {
+			return;
+		}
+	}
+}
+
+void UdpServer::sendTo(details::SocketAddress const &remoteAddress, char const *data, uint32_t length) const {
+	// Closed by the shutdown of the registered I/O mode.
+	RAPID_ENSURE(pSocket_ != nullptr);
+	auto ret = ::sendto(pSocket_->socketFd(), data, length, 0, remoteAddress.getSockAddr(), remoteAddress.getAddressLength());
+	if (ret == SOCKET_ERROR) {
+		throw Exception(::WSAGetLastError());
+	}
+}
+
+void UdpServer::shutdown() {
+	static auto constexpr MAX_WAIT_CANCEL_COUNT = 5000;
+
+	if (!isRunning_.exchange(false)) {
+		return;
+	}
+
+	RAPID_LOG_INFO() << "Shutting down UDP server...";
+
+	if (pRegisteredReceiver_ != nullptr) {
+		// Registered receives can't be cancelled, closing the socket completes them.
+		pSocket_.reset();
+	}
+
+	// Abort the outstanding receives and wait until every receiver has seen the stop flag.
+	// A receive posted between the flag and the cancel is cancelled by the next round.
+	for (auto i = 0; activeReceivers_ > 0; ++i) {
+		if (i == MAX_WAIT_CANCEL_COUNT) {
+			// Dispatcher threads have gone, the receivers can't be freed safely.
+			RAPID_LOG_WARN() << activeReceivers_ << " datagram receivers still pending!";
+			for (auto &pReceiver : receivers_) {
+				pReceiver.release();
+			}
+			pRegisteredReceiver_.release();
+			break;
+		}
+		if (pSocket_ != nullptr) {
+			::CancelIoEx(pSocket_->handle(), nullptr);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	receivers_.clear();
+	pRegisteredReceiver_.reset();
+}
+
+}